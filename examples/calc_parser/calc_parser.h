@@ -71,6 +71,27 @@ namespace num_parser {
             return expression.Peek(stream);
         }
     };
+
+
+// The same grammar as a single precedence-climbing parser: one rule for all binary operators.
+    struct LazyPrattExpr;
+
+    constexpr auto pratt_factor = number | (lparen >> Lazy<char,LazyPrattExpr>() >> rparen).Name("factor");
+
+    constexpr auto pratt_expression = Pratt(pratt_factor,
+                                            InfixLeft(add, 1, [](double l, double r) { return l + r; }),
+                                            InfixLeft(sub, 1, [](double l, double r) { return l - r; }),
+                                            InfixLeft(mul, 2, [](double l, double r) { return l * r; }),
+                                            InfixLeft(div, 2, [](double l, double r) { return l / r; })).Name("expression");
+
+    struct LazyPrattExpr : public base_parser<char,LazyPrattExpr> {
+        std::optional<double> parse_impl(auto& stream,auto g_ctx,auto ctx) const {
+            return pratt_expression.Parse(stream,g_ctx,ctx);
+        }
+        bool peek_impl(auto& stream) const {
+            return pratt_expression.Peek(stream);
+        }
+    };
 }
 
 #endif //LIGHT_PARSER_CALC_PARSER_H
@@ -77,6 +77,18 @@ TEST_F(ArithmeticParserTest, EdgeCases) {
     }
 }
 
+TEST_F(ArithmeticParserTest, PrattExpression) {
+    for (auto input : {"2+3*4", "10-4-3", "8/2/2", "3+5*2/(8-6)", "((3+5)*2-1)/3", "(1+2)*(3+4)/(5-2)"}) {
+        string_stream stream(input);
+        auto result = num_parser::pratt_expression.Parse(stream);
+        ASSERT_TRUE(result.has_value()) << input;
+        EXPECT_NEAR(*result, parse(input), epsilon) << input;
+    }
+
+    string_stream stream("2+a");
+    EXPECT_THROW(num_parser::pratt_expression.Parse(stream),pkuyo::parsers::parser_exception);
+}
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
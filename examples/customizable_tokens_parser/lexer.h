@@ -6,7 +6,7 @@
 #define LIGHT_PARSER_LEXER_H
 
 #include <utility>
-#include <regex>
+#include "pkuyo/parser.h"
 
 
 enum class token_type {
@@ -63,18 +63,17 @@ public:
     // 词法分析函数
     std::vector<Token> tokenize() {
         std::vector<Token> tokens;
-        while (position < input.length()) {
+        pkuyo::parsers::string_view_stream stream(input);
+        stream.Seek(position);
+        while (!stream.Eof()) {
             bool matched = false;
             for (const auto &pattern: tokenPatterns) {
-                std::regex regex(pattern.second);
-                std::smatch match;
-                if (std::regex_search(input.cbegin() + position, input.cend(), match, regex,
-                                      std::regex_constants::match_continuous)) {
-                    std::string value = match.str(0);
+                // A failed match consumes nothing, so each pattern's DFA is walked once per attempt.
+                if (auto value = pattern.second.Parse(stream)) {
                     if (pattern.first != token_type::WHITESPACE) {
-                        tokens.push_back({pattern.first, value});
+                        tokens.push_back({pattern.first, std::string(*value)});
                     }
-                    position += value.length();
+                    position += value->length();
                     matched = true;
                     break;
                 }
@@ -90,19 +89,21 @@ private:
     std::string input;
     size_t position;
 
-    const std::vector<std::pair<token_type, std::string>> tokenPatterns = {
-            {token_type::LBRACE,     R"(\{)"},          // {
-            {token_type::RBRACE,     R"(\})"},          // }
-            {token_type::LBRACKET,   R"(\[)"},          // [
-            {token_type::RBRACKET,   R"(\])"},          // ]
-            {token_type::COLON,      R"(:)"},           // :
-            {token_type::COMMA,      R"(,)"},           // ,
-            {token_type::STRING,     R"("(?:\\.|[^"\\])*")"}, // string
-            {token_type::NUMBER,     R"(-?\d+(?:\.\d+)?(?:[eE][+-]?\d+)?)"}, // number
-            {token_type::TRUE_,       R"(true)"},        // true
-            {token_type::FALSE_,      R"(false)"},       // false
-            {token_type::NULL_,      R"(null)"},        // null
-            {token_type::WHITESPACE, R"(\s+)"}         // 空白字符
+    // Compiled once per lexer; each match walks the pattern's DFA over the input without copying it.
+    //  Patterns are silenced with NoError(), since trying the next one is the normal outcome of a mismatch.
+    const std::vector<std::pair<token_type, pkuyo::parsers::parser_regex<char>>> tokenPatterns = {
+            {token_type::LBRACE,     pkuyo::parsers::Regex(R"(\{)").NoError()},          // {
+            {token_type::RBRACE,     pkuyo::parsers::Regex(R"(\})").NoError()},          // }
+            {token_type::LBRACKET,   pkuyo::parsers::Regex(R"(\[)").NoError()},          // [
+            {token_type::RBRACKET,   pkuyo::parsers::Regex(R"(\])").NoError()},          // ]
+            {token_type::COLON,      pkuyo::parsers::Regex(R"(:)").NoError()},           // :
+            {token_type::COMMA,      pkuyo::parsers::Regex(R"(,)").NoError()},           // ,
+            {token_type::STRING,     pkuyo::parsers::Regex(R"("(?:\\.|[^"\\])*")").NoError()}, // string
+            {token_type::NUMBER,     pkuyo::parsers::Regex(R"(-?\d+(?:\.\d+)?(?:[eE][+-]?\d+)?)").NoError()}, // number
+            {token_type::TRUE_,      pkuyo::parsers::Regex(R"(true)").NoError()},        // true
+            {token_type::FALSE_,     pkuyo::parsers::Regex(R"(false)").NoError()},       // false
+            {token_type::NULL_,      pkuyo::parsers::Regex(R"(null)").NoError()},        // null
+            {token_type::WHITESPACE, pkuyo::parsers::Regex(R"(\s+)").NoError()}         // 空白字符
     };
 };
 
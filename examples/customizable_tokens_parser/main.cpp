@@ -9,6 +9,7 @@
 #include "lexer.h"
 #include "ast_node.h"
 #include <string>
+#include <cctype>
 /*
  *   JSON       = Value ;
  *   Value      = Object | Array | STRING | NUMBER | TRUE | FALSE | NULL ;
@@ -93,12 +94,57 @@ namespace json {
     auto & parser = value;
 }
 
+// Lexer written with the same combinators, producing one Token per call.
+namespace json_lexer {
+    using namespace pkuyo::parsers;
+
+    auto token_of(token_type type) {
+        return [type](auto &&text) { return Token{type, std::string(text)}; };
+    }
+
+    auto punct(char c, token_type type) {
+        return Check<char>(char{c}) >>= [c, type](auto &&) { return Token{type, std::string(1, c)}; };
+    }
+
+    // An escape is kept as written, so an escaped quote does not end the string.
+    auto escape = Check<char>('\\') >> SingleValue<char>([](char) { return true; }) >>= [](char c) {
+        return std::string{'\\', c};
+    };
+
+    auto plain = SingleValue<char>([](char c) { return c != '"' && c != '\\'; }) >>= [](char c) {
+        return std::string(1, c);
+    };
+
+    // Keeps the quotes, like the regex-based JSONLexer.
+    auto string = (Check<char>('"') >> *(escape | plain) >> '"') >>= [](auto &&parts) {
+        std::string text = "\"";
+        for (auto &part: parts)
+            text += part;
+        return Token{token_type::STRING, text + '"'};
+    };
+
+    auto number = +SingleValue<char>([](char c) {
+        return std::isdigit(static_cast<unsigned char>(c)) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+    }) >>= token_of(token_type::NUMBER);
+
+    auto keyword = (Str("true") >>= token_of(token_type::TRUE_))
+            | (Str("false") >>= token_of(token_type::FALSE_))
+            | (Str("null") >>= token_of(token_type::NULL_));
+
+    auto token = (punct('{', token_type::LBRACE) | punct('}', token_type::RBRACE)
+            | punct('[', token_type::LBRACKET) | punct(']', token_type::RBRACKET)
+            | punct(':', token_type::COLON) | punct(',', token_type::COMMA)
+            | string | number | keyword).Name("Token");
+
+    auto whitespace = *Check<char>([](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; });
+}
+
 int main() {
 
 
     std::string input =R"(
     {
-        "name": "John Doe",
+        "name": "John \"JD\" Doe",
         "age": 30,
         "is_student": false,
         "skills": ["C++", "Python", "JavaScript"],
@@ -109,8 +155,9 @@ int main() {
     }
     )";
 
-    auto lexer = JSONLexer(input);
-    pkuyo::parsers::container_stream<std::vector<Token>> token_stream(lexer.tokenize());
+    // Tokens are lexed on demand while parsing instead of materializing the whole token vector first.
+    pkuyo::parsers::string_stream char_stream(input);
+    auto token_stream = pkuyo::parsers::LexerStream(char_stream, json_lexer::token, json_lexer::whitespace);
 
     auto result = json::parser.Parse(token_stream);
 
@@ -72,12 +72,13 @@ namespace xml {
 
     struct lazy_element;
 
-    constexpr auto tag_name = (+SingleValue<char>([](auto c) {return isalpha(c) || c == '_' || c == ':';})).Name("tag_name");
+    // Names and attribute values are views into the mapped file; they are only copied into the element tree.
+    constexpr auto tag_name = Capture(+SingleValue<char>([](auto c) {return isalpha(c) || c == '_' || c == ':';})).Name("tag_name");
 
-    constexpr auto quoted_str = (('"' >> Until<char>('"') >> '"') | ('\'' >> Until<char>('\'') >> '\'')).Name("quoted_str");
+    constexpr auto quoted_str = (('"' >> Capture(Until<char>('"')) >> '"') | ('\'' >> Capture(Until<char>('\'')) >> '\'')).Name("quoted_str");
 
     constexpr auto attribute =  ( (tag_name >> '=' >> quoted_str >> skip_space)
-                                          >>= [] (tuple<std::string, std::string> && part, XmlStack & ctx) {
+                                          >>= [] (tuple<std::string_view, std::string_view> && part, XmlStack & ctx) {
                 ctx.top()->attributes.emplace_back(std::move(part));
                 return nullptr;
             }).Name("attribute");
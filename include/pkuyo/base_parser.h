@@ -11,15 +11,297 @@
  * - Generic parser template base_parser
  * - Parser naming wrapper named_parser
  * - Parser concept definition is_parser
+ * - Literal sequence matching helper match_sequence
+ * - Bulk delimiter scanning helper skip_until
+ * - Per-parse caches of parsers, kept outside the parser objects (parse_caches)
+ * - First-token sets used for Or dispatch (first_set)
+ * - k-token prefix sets used for LL(k) prediction (prefix_set)
  */
 
 #ifndef LIGHT_PARSER_BASE_PARSER_H
 #define LIGHT_PARSER_BASE_PARSER_H
 
 #include "error_handler.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
 
 namespace pkuyo::parsers {
 
+    // Checks whether the upcoming tokens of `stream` equal `expected[0..size)` without consuming them.
+    //  Contiguous streams are compared as one block (memcmp when the tokens are plain bytes or integers);
+    //  other streams fall back to a `Peek()` per token.
+    template<typename Stream, typename cmp_type>
+    bool match_sequence(Stream &stream, const cmp_type *expected, size_t size) {
+        if constexpr (is_contiguous_stream_v<Stream>) {
+            auto window = stream.Window(size);
+            if (window.size() < size)
+                return false;
+            using token_type = typename decltype(window)::value_type;
+            if constexpr (std::is_same_v<token_type, cmp_type> && std::has_unique_object_representations_v<cmp_type>)
+                return std::memcmp(window.data(), expected, size * sizeof(cmp_type)) == 0;
+            else
+                return std::equal(window.begin(), window.end(), expected);
+        } else {
+            for (size_t i = 0; i < size; i++) {
+                if (stream.Eof(i) || stream.Peek(i) != expected[i])
+                    return false;
+            }
+            return true;
+        }
+    }
+
+    // Predicate matching tokens equal to `value`. Scans for it are vectorized on byte streams (see `skip_until`).
+    template<typename token_type>
+    struct token_equal {
+        token_type value;
+
+        constexpr bool operator()(const token_type &token) const {
+            return token == value;
+        }
+    };
+
+    // Index of the first token in `block` accepted by `stop`, or `block.size()` if there is none.
+    //  Predicates with a `find(block)` member search the block themselves.
+    template<typename token_type, typename stop_type>
+    size_t find_stop(std::span<const token_type> block, const stop_type &stop) {
+        if constexpr (std::is_same_v<stop_type, token_equal<token_type>> && sizeof(token_type) == 1 && std::is_integral_v<token_type>)
+            return simd::find_byte(reinterpret_cast<const char *>(block.data()), block.size(), static_cast<char>(stop.value));
+        else if constexpr (requires { stop.find(block); })
+            return stop.find(block);
+        else
+            return std::find_if(block.begin(), block.end(), stop) - block.begin();
+    }
+
+    // Consumes the upcoming tokens of contiguous streams up to the first one accepted by `stop` (or the end of the
+    //  received input), a `Window()` block at a time. `on_run(span)` receives each consumed run before the cursor moves
+    //  past it. The caller finishes with its usual per-token loop, which then stops at once, or reports EOF and
+    //  `need_more_input` the usual way.
+    template<typename Stream, typename stop_type, typename run_type>
+    void skip_until(Stream &stream, const stop_type &stop, run_type &&on_run) {
+        constexpr size_t block_size = 4096;
+        while (true) {
+            size_t request = block_size;
+            // push_stream: only look at tokens that were already received.
+            if constexpr (requires { stream.Available(); })
+                request = stream.Available();
+            if (request == 0)
+                return;
+            auto block = stream.Window(request);
+            if (block.empty())
+                return;
+            size_t run = find_stop(block, stop);
+            on_run(block.first(run));
+            stream.Seek(run);
+            if (run < block.size())
+                return;
+        }
+    }
+
+    // Whether parsers on this thread report errors (see `error_handle_recovery`). Left-recursion growth rounds
+    //  turn reporting off, since their failure only ends the growth; TryCatch turns it back on for its child.
+    inline bool &error_reporting_enabled() {
+        thread_local bool enabled = true;
+        return enabled;
+    }
+
+    // Sets `error_reporting_enabled()` for the lifetime of the scope.
+    struct error_reporting_scope {
+        explicit error_reporting_scope(bool enabled) : previous(std::exchange(error_reporting_enabled(), enabled)) {}
+
+        ~error_reporting_scope() {
+            error_reporting_enabled() = previous;
+        }
+
+        error_reporting_scope(const error_reporting_scope &) = delete;
+        error_reporting_scope &operator=(const error_reporting_scope &) = delete;
+
+        bool previous;
+    };
+
+    // Whether the running top-level call on this thread is `Validate`, which builds no results at all:
+    //  mappers without states are skipped there. Under `-parser` inside a `Parse` they still run.
+    inline bool &validating() {
+        thread_local bool active = false;
+        return active;
+    }
+
+    // Sets `validating()` for the lifetime of the scope.
+    struct validating_scope {
+        explicit validating_scope(bool active) : previous(std::exchange(validating(), active)) {}
+
+        ~validating_scope() {
+            validating() = previous;
+        }
+
+        validating_scope(const validating_scope &) = delete;
+        validating_scope &operator=(const validating_scope &) = delete;
+
+        bool previous;
+    };
+
+    // A cache a parser keeps for the duration of a parse (e.g. Memo's table).
+    //  `type_tag` identifies the concrete cache type, so owners can check it without RTTI.
+    struct parse_cache_base {
+        explicit parse_cache_base(const void *_type_tag) : type_tag(_type_tag) {}
+        virtual ~parse_cache_base() = default;
+
+        const void *type_tag;
+    };
+
+    // Per-parse caches on this thread, keyed by the address of the parser owning them. Keeping them outside
+    //  the parser objects leaves parsers literal types, so they can still be part of constexpr grammars.
+    //  The caches are dropped when the outermost top-level `Parse` / `Validate` on the thread returns.
+    inline std::unordered_map<const void *, std::unique_ptr<parse_cache_base>> &parse_caches() {
+        thread_local std::unordered_map<const void *, std::unique_ptr<parse_cache_base>> caches;
+        return caches;
+    }
+
+    // Number of top-level `Parse` / `Validate` calls running on this thread (they nest, e.g. in lexer_stream).
+    inline size_t &parse_depth() {
+        thread_local size_t depth = 0;
+        return depth;
+    }
+
+    // Tokens that can be used as an index into a first_set: characters, small integers and enums.
+    template<typename token_type>
+    constexpr bool has_first_key_v = (std::is_integral_v<token_type> || std::is_enum_v<token_type>) && !std::is_same_v<token_type, bool>;
+
+    // Index of `token` in a first_set. Values outside [0, 256) never belong to a set.
+    template<typename token_type>
+    constexpr size_t first_key(const token_type &token) {
+        if constexpr (std::is_enum_v<token_type>)
+            return static_cast<size_t>(static_cast<std::underlying_type_t<token_type>>(token));
+        else if constexpr (sizeof(token_type) == 1)
+            return static_cast<unsigned char>(token);
+        else
+            return static_cast<size_t>(token);
+    }
+
+    // The set of tokens a parser can start with, as a bitmap over `first_key` values.
+    //  An unknown set (`known == false`) means the parser may start with any token or match empty input.
+    struct first_set {
+        bool known = false;
+        uint64_t bits[4]{};
+
+        static constexpr first_set of(size_t key) {
+            first_set set;
+            if (key < 256) {
+                set.known = true;
+                set.bits[key >> 6] |= uint64_t(1) << (key & 63);
+            }
+            return set;
+        }
+
+        [[nodiscard]] constexpr bool contains(size_t key) const {
+            return key < 256 && ((bits[key >> 6] >> (key & 63)) & 1);
+        }
+
+        [[nodiscard]] constexpr bool intersects(const first_set &other) const {
+            return (bits[0] & other.bits[0]) || (bits[1] & other.bits[1]) ||
+                   (bits[2] & other.bits[2]) || (bits[3] & other.bits[3]);
+        }
+
+        constexpr first_set operator|(const first_set &other) const {
+            first_set set;
+            set.known = known && other.known;
+            for (size_t i = 0; i < 4; i++)
+                set.bits[i] = bits[i] | other.bits[i];
+            return set;
+        }
+    };
+
+    // The token sequences, up to `k` tokens long, that a parser's match can start with.
+    //  A `complete` entry is a whole match of at most `k` tokens; other entries may be followed by any tokens.
+    //  An unknown set (`known == false`) gives no prediction, e.g. for predicates or parsers that can match empty input.
+    //  Sets with more than `capacity` entries are treated as unknown.
+    template<typename token_type, size_t k, size_t capacity = 16>
+    struct prefix_set {
+        struct entry {
+            token_type tokens[k]{};
+            size_t size = 0;
+            bool complete = false;
+        };
+
+        bool known = false;
+        size_t count = 0;
+        entry entries[capacity]{};
+
+        static constexpr prefix_set of(const token_type *sequence, size_t size) {
+            prefix_set set;
+            if (size == 0)
+                return set;
+            entry e;
+            e.size = std::min(size, k);
+            e.complete = size <= k;
+            std::copy_n(sequence, e.size, e.tokens);
+            set.known = true;
+            set.add(e);
+            return set;
+        }
+
+        constexpr prefix_set operator|(const prefix_set &other) const {
+            if (!known || !other.known)
+                return {};
+            prefix_set set = *this;
+            for (size_t i = 0; i < other.count; i++)
+                if (!set.add(other.entries[i]))
+                    return {};
+            return set;
+        }
+
+        // The prefixes of a match of this parser followed by a match of the parser with prefixes `next`.
+        constexpr prefix_set then(const prefix_set &next) const {
+            if (!known)
+                return {};
+            prefix_set set;
+            set.known = true;
+            for (size_t i = 0; i < count; i++) {
+                entry e = entries[i];
+                if (!e.complete || !next.known) {
+                    e.complete = false;
+                    if (!set.add(e))
+                        return {};
+                    continue;
+                }
+                for (size_t j = 0; j < next.count; j++) {
+                    entry joined = e;
+                    const entry &tail = next.entries[j];
+                    size_t take = std::min(tail.size, k - e.size);
+                    std::copy_n(tail.tokens, take, joined.tokens + e.size);
+                    joined.size = e.size + take;
+                    joined.complete = tail.complete && take == tail.size;
+                    if (!set.add(joined))
+                        return {};
+                }
+            }
+            return set;
+        }
+
+        // Checks whether the upcoming tokens of `stream` start with one of the prefixes, without consuming them.
+        template<typename Stream>
+        bool match(Stream &stream) const {
+            for (size_t i = 0; i < count; i++)
+                if (match_sequence(stream, entries[i].tokens, entries[i].size))
+                    return true;
+            return false;
+        }
+
+    private:
+        constexpr bool add(const entry &e) {
+            for (size_t i = 0; i < count; i++)
+                if (entries[i].size == e.size && entries[i].complete == e.complete &&
+                    std::equal(e.tokens, e.tokens + e.size, entries[i].tokens))
+                    return true;
+            if (count == capacity)
+                return false;
+            entries[count++] = e;
+            return true;
+        }
+    };
+
     // Abstract base class for `parser`. Used when:
     //  1. Only the name matters;
     //  2. Unified exception handling is needed;
@@ -37,14 +319,18 @@ namespace pkuyo::parsers {
         constexpr _abstract_parser() = default;
 
         // Handles exception recovery. Invoked on `Parse` errors and may throw `parser_exception`.
+        // The token value and position are only formatted if the handler renders them.
+        // Streams with the `status` error policy only record the failure (see status_stream).
         template<typename Stream>
         void error_handle_recovery(Stream & stream) const {
-            if (no_error)
+            if (no_error || !error_reporting_enabled())
                 return;
-            if (!error_handler)     parser_error_handler<token_type>::error_handler(*this,stream.Eof() ?
-            std::nullopt : std::make_optional(stream.Peek()),stream.Value(),stream.Pos(),stream.Name());
+            if constexpr (stream_error_policy_v<Stream> == error_policy::status)
+                stream.Fail(Name());
+            else if (!error_handler)     parser_error_handler<token_type>::error_handler(*this,stream.Eof() ?
+            std::nullopt : std::make_optional(stream.Peek()),lazy_text::value_of(stream),lazy_text::position_of(stream),stream.Name());
             else                    error_handler(*this,stream.Eof() ? std::nullopt : std::make_optional(stream.Peek()),
-                                                  stream.Value(),stream.Pos(),stream.Name());
+                                                  lazy_text::value_of(stream),lazy_text::position_of(stream),stream.Name());
 
         }
 
@@ -79,7 +365,7 @@ namespace pkuyo::parsers {
             no_error_internal();
             return static_cast<derived_type&>(*this);
         }
-        // Predicts if this `parser` can correctly parse the input (single-character lookahead).
+        // Predicts if this `parser` can correctly parse the input (single-token lookahead; see `LookAhead` for k tokens).
         template <typename Stream>
         auto Peek(Stream& stream) const {
             return static_cast<const derived_type&>(*this).peek_impl(stream);
@@ -89,6 +375,7 @@ namespace pkuyo::parsers {
         template <typename Stream>
         auto Parse(Stream& stream) const {
             this->Reset();
+            reset_scope release{*this};
             nullptr_t local_state= nullptr;
             nullptr_t global_state = nullptr;
             return static_cast<const derived_type&>(*this).parse_impl(stream,global_state,local_state);
@@ -97,6 +384,7 @@ namespace pkuyo::parsers {
         template <typename Stream,typename GlobalState>
         auto Parse(Stream& stream,GlobalState & global_state) const {
             this->Reset();
+            reset_scope release{*this};
             nullptr_t t= nullptr;
             return static_cast<const derived_type&>(*this).parse_impl(stream,global_state,t);
         }
@@ -107,23 +395,79 @@ namespace pkuyo::parsers {
             return re;
         }
 
+        // Checks that the input matches and advances past it like `Parse`, without building any result.
+        // (May throw exceptions.)
+        template <typename Stream>
+        bool Validate(Stream& stream) const {
+            this->Reset();
+            reset_scope release{*this};
+            validating_scope validate(true);
+            nullptr_t local_state= nullptr;
+            nullptr_t global_state = nullptr;
+            return static_cast<const derived_type&>(*this).recognize_impl(stream,global_state,local_state);
+        }
+
+        template <typename Stream,typename GlobalState>
+        bool Validate(Stream& stream,GlobalState & global_state) const {
+            this->Reset();
+            reset_scope release{*this};
+            validating_scope validate(true);
+            nullptr_t t= nullptr;
+            return static_cast<const derived_type&>(*this).recognize_impl(stream,global_state,t);
+        }
+
+        // Recognize-only counterpart of `parse_impl`, used where the result is discarded (`-parser`, `Validate`).
+        //  Falls back to `parse_impl`; parsers that build containers or values override it to skip the construction.
+        template<typename Stream, typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState& global_state, State& state) const {
+            return static_cast<const derived_type&>(*this).parse_impl(stream,global_state,state).has_value();
+        }
+
         void reset_impl() const { }
 
         void no_error_impl() {}
 
-    protected:
+        // Tokens this parser can start with. Unknown unless the parser overrides it.
+        constexpr first_set first_set_impl() const { return {}; }
+
+        // Token sequences of length up to `k` this parser can start with. Unknown unless the parser overrides it.
+        template<size_t k>
+        constexpr prefix_set<token_type, k> prefix_impl() const { return {}; }
 
+        // Disables the error handler of this parser and, through `no_error_impl`, of its children.
+        // (Called by combinators on their children.)
         void no_error_internal() {
             if(!this->no_error) {
                 this->no_error = true;
-                no_error_impl();
+                static_cast<derived_type&>(*this).no_error_impl();
             }
         }
 
+    protected:
+
         void Reset() const {
             static_cast<const derived_type&>(*this).reset_impl();
         }
 
+        // Resets the parser again when a top-level `Parse` / `Validate` returns (or throws), and drops the
+        //  per-parse caches (see `parse_caches`) once the outermost one returns, so they do not outlive the parse.
+        struct reset_scope {
+            explicit reset_scope(const base_parser &_parser) : parser(_parser) {
+                parse_depth()++;
+            }
+
+            ~reset_scope() {
+                parser.Reset();
+                if (--parse_depth() == 0)
+                    parse_caches().clear();
+            }
+
+            reset_scope(const reset_scope &) = delete;
+            reset_scope &operator=(const reset_scope &) = delete;
+
+            const base_parser &parser;
+        };
+
 
 
         constexpr base_parser() = default;
@@ -9,8 +9,14 @@
  * Includes:
  * - Logical combinators (NOT/PRED/THEN/OR)
  * - Sequence processing parsers (UNTIL/STR/SEQ)
+ * - Zero-copy capture of consumed tokens (CAPTURE)
+ * - Character classes backed by a 256-bit table (CHARSET)
+ * - Keyword sets compiled into a trie (KEYWORDS)
  * - Repetition matching parsers (MANY/MORE)
  * - Lazy parsers (LAZY)
+ * - k-token lookahead prediction (LOOKAHEAD)
+ * - Packrat memoization (MEMO)
+ * - Operator-precedence expressions (PRATT)
  * - Semantic action parsers (MAP/WHERE)
  * - Operator overloading for syntactic composition
  */
@@ -19,6 +25,10 @@
 #define LIGHT_PARSER_COMPILE_TIME_PARSER_H
 
 #include "base_parser.h"
+#include <memory>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
 
 
 namespace pkuyo::parsers {
@@ -95,12 +105,85 @@ namespace pkuyo::parsers {
 
         template<typename Stream, typename GlobalState, typename State>
         auto parse_impl(Stream& stream, GlobalState& global_state, State& state) const {
-            auto re = child_parser.parse_impl(stream,global_state,state);
-            if(re)
+            if(child_parser.recognize_impl(stream,global_state,state))
                 return std::make_optional(nullptr);
             return std::optional<nullptr_t>();
         }
 
+        template<typename Stream, typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState& global_state, State& state) const {
+            return child_parser.recognize_impl(stream,global_state,state);
+        }
+
+        template<typename Stream>
+        bool peek_impl(Stream & stream) const {
+            return child_parser.peek_impl(stream);
+        }
+
+        void reset_impl() const {
+            child_parser.reset_impl();
+        }
+
+        void no_error_impl() {
+            child_parser.no_error_internal();
+        }
+
+        constexpr first_set first_set_impl() const {
+            return child_parser.first_set_impl();
+        }
+
+        template<size_t k>
+        constexpr auto prefix_impl() const {
+            return child_parser.template prefix_impl<k>();
+        }
+    private:
+        child_type child_parser;
+    };
+
+    // A parser that returns the tokens consumed by the child parser instead of the child's result.
+    //  The child runs in recognize-only mode. On streams with stable windows (`has_stable_window_v`: string, view,
+    //  span, contiguous container and mmap streams) the result is a view into the stream's buffer
+    //  (std::basic_string_view for char or wchar_t, std::span otherwise), valid until the stream (or the buffer
+    //  it borrows) is destroyed. Other streams copy the tokens into std::basic_string / std::vector; this includes
+    //  push_stream, windowed_mmap_file_stream and utf8_stream, whose windows are refilled, remapped or re-decoded.
+    template<typename child_type>
+    class parser_capture : public base_parser<typename std::decay_t<child_type>::token_t,parser_capture<child_type>>{
+    public:
+        using token_t = typename std::decay_t<child_type>::token_t;
+
+        constexpr explicit parser_capture(const child_type & _child_parser) : child_parser(_child_parser) {}
+
+        template<typename Stream, typename GlobalState, typename State>
+        auto parse_impl(Stream& stream, GlobalState& global_state, State& state) const {
+            using result_type = std::conditional_t<has_stable_window_v<Stream>,
+                    result_view_t<token_t>, result_container_t<token_t>>;
+            auto start = stream.Save();
+            size_t start_index = stream.Index();
+            if (!child_parser.recognize_impl(stream, global_state, state))
+                return std::optional<result_type>();
+            size_t length = stream.Index() - start_index;
+            stream.Restore(start);
+            if constexpr (is_contiguous_stream_v<Stream>) {
+                // The block of an unstable window is copied before `Seek()` may refill or remap it.
+                auto block = stream.Window(length);
+                auto result = std::make_optional(result_type(block.begin(), block.end()));
+                stream.Seek(length);
+                return result;
+            }
+            else {
+                result_type result;
+                result.reserve(length);
+                for (size_t i = 0; i < length; i++)
+                    result.push_back(stream.Get());
+                return std::make_optional(std::move(result));
+            }
+        }
+
+        template<typename Stream, typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState& global_state, State& state) const {
+            return child_parser.recognize_impl(stream,global_state,state);
+        }
+
         template<typename Stream>
         bool peek_impl(Stream & stream) const {
             return child_parser.peek_impl(stream);
@@ -113,6 +196,15 @@ namespace pkuyo::parsers {
         void no_error_impl() {
             child_parser.no_error_internal();
         }
+
+        constexpr first_set first_set_impl() const {
+            return child_parser.first_set_impl();
+        }
+
+        template<size_t k>
+        constexpr auto prefix_impl() const {
+            return child_parser.template prefix_impl<k>();
+        }
     private:
         child_type child_parser;
     };
@@ -147,6 +239,21 @@ namespace pkuyo::parsers {
             return !stream.Eof() && stream.Peek() == cmp_value;
         }
 
+        constexpr first_set first_set_impl() const {
+            if constexpr (has_first_key_v<token_type> && std::is_same_v<std::decay_t<cmp_type>,token_type>)
+                return first_set::of(first_key(cmp_value));
+            else
+                return {};
+        }
+
+        template<size_t k>
+        constexpr auto prefix_impl() const {
+            if constexpr (std::is_same_v<std::decay_t<cmp_type>,token_type>)
+                return prefix_set<token_type,k>::of(&cmp_value, 1);
+            else
+                return prefix_set<token_type,k>{};
+        }
+
     private:
         cmp_type cmp_value;
     };
@@ -197,13 +304,24 @@ namespace pkuyo::parsers {
         }
         template<typename Stream>
         bool peek_impl(Stream & stream) const {
-            for(int i = 0; i< real_size;i++) {
-                if(stream.Eof(i) || stream.Peek(i) != cmp[i]) {
-                    return false;
-                }
-            }
-            return true;
+            return match_sequence(stream, cmp, real_size);
+        }
+
+        constexpr first_set first_set_impl() const {
+            if constexpr (has_first_key_v<token_type> && std::is_same_v<buff_type,token_type> && real_size > 0)
+                return first_set::of(first_key(cmp[0]));
+            else
+                return {};
         }
+
+        template<size_t k>
+        constexpr auto prefix_impl() const {
+            if constexpr (std::is_same_v<buff_type,token_type>)
+                return prefix_set<token_type,k>::of(cmp, real_size);
+            else
+                return prefix_set<token_type,k>{};
+        }
+
         static constexpr size_t real_size = (std::is_same_v<buff_type,char> || std::is_same_v<buff_type,wchar_t>) ? buff_size-1 : buff_size;
 
         buff_type cmp[buff_size]{};
@@ -226,12 +344,33 @@ namespace pkuyo::parsers {
             if (!peek_impl(stream))
                 return std::optional<result_container_t<token_type>>();
             result_container_t<token_type> result;
+            if constexpr (is_contiguous_stream_v<Stream>)
+                skip_until(stream, stop(), [&result](auto run) { result.insert(result.end(), run.begin(), run.end()); });
             while (!stream.Eof() && stream.Peek() != cmp) {
                 result.push_back(stream.Get());
             }
             return std::make_optional(std::move(result));
 
         }
+
+        template<typename Stream, typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState&, State&) const {
+            if (!peek_impl(stream))
+                return false;
+            if constexpr (is_contiguous_stream_v<Stream>)
+                skip_until(stream, stop(), [](auto) {});
+            while (!stream.Eof() && stream.Peek() != cmp)
+                stream.Seek(1);
+            return true;
+        }
+
+        // Stop predicate for bulk scans; plain token comparisons are vectorized for bytes.
+        constexpr auto stop() const {
+            if constexpr (std::is_same_v<std::decay_t<cmp_type>, token_type>)
+                return token_equal<token_type>{cmp};
+            else
+                return [this](const token_type &token) { return token == cmp; };
+        }
         bool peek_impl(auto & stream) const {
             if(stream.Eof() || stream.Peek() == cmp)
                 return false;
@@ -256,11 +395,24 @@ namespace pkuyo::parsers {
             if (!peek_impl(stream))
                 return std::optional<result_container_t<token_type>>();
             result_container_t<token_type> result;
+            if constexpr (is_contiguous_stream_v<Stream>)
+                skip_until(stream, cmp, [&result](auto run) { result.insert(result.end(), run.begin(), run.end()); });
             while (!stream.Eof() && !cmp(stream.Peek())) {
                 result.push_back(stream.Get());
             }
             return std::make_optional(std::move(result));
         }
+
+        template<typename Stream, typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState&, State&) const {
+            if (!peek_impl(stream))
+                return false;
+            if constexpr (is_contiguous_stream_v<Stream>)
+                skip_until(stream, cmp, [](auto) {});
+            while (!stream.Eof() && !cmp(stream.Peek()))
+                stream.Seek(1);
+            return true;
+        }
         bool peek_impl(auto & stream) const {
             if(stream.Eof() || cmp(stream.Peek()))
                 return false;
@@ -296,6 +448,16 @@ namespace pkuyo::parsers {
 
         }
 
+        template<typename Stream, typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState&, State&) const {
+            if(!this->peek_impl(stream)){
+                this->error_handle_recovery(stream);
+                return false;
+            }
+            stream.Seek(1);
+            return true;
+        }
+
         template<typename Stream>
         bool peek_impl(Stream & stream) const {
             return !stream.Eof() && cmp_func(stream.Peek());
@@ -326,11 +488,9 @@ namespace pkuyo::parsers {
 
         template<typename Stream, typename GlobalState, typename State>
         auto parse_impl(Stream& stream, GlobalState&, State&) const {
-            for(int i = 0;i<real_size;i++) {
-                if(stream.Peek(i) != cmp_value[i]) {
-                    this->error_handle_recovery(stream);
-                    return std::optional<std::basic_string_view<token_type>>();
-                }
+            if(!match_sequence(stream, cmp_value, real_size)) {
+                this->error_handle_recovery(stream);
+                return std::optional<std::basic_string_view<token_type>>();
             }
             stream.Seek(real_size);
             return std::make_optional(std::basic_string_view<token_type>(cmp_value));
@@ -342,12 +502,142 @@ namespace pkuyo::parsers {
             return !stream.Eof() && stream.Peek() == *cmp_value;
         }
 
+        constexpr first_set first_set_impl() const {
+            if constexpr (has_first_key_v<token_type> && real_size > 0)
+                return first_set::of(first_key(cmp_value[0]));
+            else
+                return {};
+        }
+
+        template<size_t k>
+        constexpr auto prefix_impl() const {
+            return prefix_set<token_type,k>::of(cmp_value, real_size);
+        }
+
     private:
         static constexpr size_t real_size = (std::is_same_v<token_type,char> || std::is_same_v<token_type,wchar_t>) ? size-1 : size;
 
         token_type cmp_value[size]{};
     };
 
+    // A trie node of a keyword set, linked to its first child and next sibling inside a flat node array.
+    //  Node 0 is the root, so a zero link means "none".
+    template<typename token_type>
+    struct keyword_node {
+        token_type label{};
+        uint32_t child = 0;
+        uint32_t sibling = 0;
+        int32_t keyword = -1;
+    };
+
+    // Inserts `word[0..size)` as keyword number `index` into the trie `nodes[0..count)`, writing new nodes after them.
+    //  Returns the new node count. A keyword that is already present keeps its first index.
+    template<typename nodes_type, typename word_type>
+    constexpr size_t keyword_insert(nodes_type &nodes, size_t count, const word_type *word, size_t size, int32_t index) {
+        uint32_t node = 0;
+        for (size_t i = 0; i < size; i++) {
+            auto label = static_cast<decltype(nodes[0].label)>(word[i]);
+            uint32_t next = nodes[node].child;
+            while (next != 0 && nodes[next].label != label)
+                next = nodes[next].sibling;
+            if (next == 0) {
+                next = static_cast<uint32_t>(count++);
+                nodes[next].label = label;
+                nodes[next].sibling = nodes[node].child;
+                nodes[node].child = next;
+            }
+            node = next;
+        }
+        if (nodes[node].keyword < 0)
+            nodes[node].keyword = index;
+        return count;
+    }
+
+    // Finds the longest keyword of the trie `nodes` at the cursor of `stream`, without consuming it.
+    //  Returns {keyword index, length}, or {-1, 0} when no keyword matches.
+    //  Contiguous streams are walked over a single `Window(max_length)` block instead of a `Peek()` per token.
+    template<typename nodes_type, typename Stream>
+    std::pair<int32_t, size_t> keyword_match(const nodes_type &nodes, Stream &stream, size_t max_length) {
+        std::pair<int32_t, size_t> longest{-1, 0};
+        uint32_t node = 0;
+        auto step = [&](const auto &token, size_t length) {
+            uint32_t next = nodes[node].child;
+            while (next != 0 && !(nodes[next].label == token))
+                next = nodes[next].sibling;
+            node = next;
+            if (node != 0 && nodes[node].keyword >= 0)
+                longest = {nodes[node].keyword, length};
+            return node != 0;
+        };
+        if constexpr (is_contiguous_stream_v<Stream>) {
+            auto window = stream.Window(max_length);
+            for (size_t i = 0; i < window.size() && step(window[i], i + 1); i++);
+        } else {
+            for (size_t i = 0; i < max_length && !stream.Eof(i) && step(stream.Peek(i), i + 1); i++);
+        }
+        return longest;
+    }
+
+    // First tokens of the keywords in the trie `nodes`.
+    template<typename nodes_type>
+    constexpr first_set keyword_first_set(const nodes_type &nodes) {
+        using token_type = std::decay_t<decltype(nodes[0].label)>;
+        if constexpr (!has_first_key_v<token_type>)
+            return first_set{};
+        else {
+            first_set set;
+            set.known = true;
+            for (uint32_t next = nodes[0].child; next != 0; next = nodes[next].sibling) {
+                if (first_key(nodes[next].label) >= 256)
+                    return first_set{};
+                set = set | first_set::of(first_key(nodes[next].label));
+            }
+            return set;
+        }
+    }
+
+    // A parser that matches the longest of a fixed set of keywords, returning its index (in declaration order).
+    //  The keywords are compiled into a trie when the parser is constructed, so every alternative is decided
+    //  by one walk over the upcoming tokens instead of a `Str()` comparison per keyword.
+    //  If no keyword matches, it attempts an error recovery strategy and returns std::nullopt.
+    template<typename token_type, size_t node_capacity>
+    class parser_keywords : public base_parser<token_type, parser_keywords<token_type,node_capacity>> {
+    public:
+
+        template<size_t ...sizes>
+        constexpr explicit parser_keywords(const char (&...words)[sizes]) {
+            int32_t index = 0;
+            ((node_count = keyword_insert(nodes, node_count, words, sizes - 1, index++),
+              max_length = std::max(max_length, sizes - 1)), ...);
+            std::copy_n("Keywords", 8, this->parser_name);
+        }
+
+        template<typename Stream, typename GlobalState, typename State>
+        auto parse_impl(Stream& stream, GlobalState&, State&) const {
+            auto [keyword, length] = keyword_match(nodes, stream, max_length);
+            if (keyword < 0) {
+                this->error_handle_recovery(stream);
+                return std::optional<size_t>();
+            }
+            stream.Seek(length);
+            return std::make_optional(static_cast<size_t>(keyword));
+        }
+
+        template<typename Stream>
+        bool peek_impl(Stream & stream) const {
+            return keyword_match(nodes, stream, max_length).first >= 0;
+        }
+
+        constexpr first_set first_set_impl() const {
+            return keyword_first_set(nodes);
+        }
+
+    private:
+        keyword_node<token_type> nodes[node_capacity]{};
+        size_t node_count = 1;
+        size_t max_length = 0;
+    };
+
 
     // A parser that only matches the first token.
     //  Requires that 'cmp_type' and 'token_type' have overloaded the == and != operators.
@@ -373,6 +663,16 @@ namespace pkuyo::parsers {
             }
             return std::optional<return_type>(std::move(constructor(stream.Get())));
         }
+
+        template<typename Stream, typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState&, State&) const {
+            if(!this->peek_impl(stream)) {
+                this->error_handle_recovery(stream);
+                return false;
+            }
+            stream.Seek(1);
+            return true;
+        }
     public:
 
         template<typename Stream>
@@ -380,12 +680,136 @@ namespace pkuyo::parsers {
             return !stream.Eof() && stream.Peek() == cmp_value;
         }
 
+        constexpr first_set first_set_impl() const {
+            if constexpr (has_first_key_v<token_type> && std::is_same_v<std::decay_t<cmp_type>,token_type>)
+                return first_set::of(first_key(cmp_value));
+            else
+                return {};
+        }
+
+        template<size_t k>
+        constexpr auto prefix_impl() const {
+            if constexpr (std::is_same_v<std::decay_t<cmp_type>,token_type>)
+                return prefix_set<token_type,k>::of(&cmp_value, 1);
+            else
+                return prefix_set<token_type,k>{};
+        }
+
     private:
 
         FF constructor;
         cmp_type cmp_value;
     };
 
+    // A parser that matches a single token from a character class, returning the token.
+    //  The class is a 256-bit table over byte values (tokens outside [0, 256) never match), built at compile time
+    //  from a pattern such as "a-zA-Z_" (ranges `x-y`, `\` escapes the next character, a leading `^` negates)
+    //  or from a single range. Under `*` and `+` on contiguous byte streams, runs are classified in bulk (see simd::class_prefix).
+    template<typename token_type>
+    class parser_char_set : public base_parser<token_type, parser_char_set<token_type>> {
+    public:
+
+        // Stop predicate for bulk scans: the first token outside the class.
+        struct run_end {
+            const uint8_t (&table)[32];
+
+            bool operator()(const token_type &token) const {
+                return !contains(table, token);
+            }
+
+            size_t find(std::span<const token_type> block) const {
+                if constexpr (sizeof(token_type) == 1 && std::is_integral_v<token_type>)
+                    return simd::class_prefix(reinterpret_cast<const char *>(block.data()), block.size(), table);
+                else
+                    return std::find_if(block.begin(), block.end(), *this) - block.begin();
+            }
+        };
+
+        template<size_t size>
+        constexpr explicit parser_char_set(const char (&pattern)[size]) {
+            size_t i = 0;
+            bool negate = size > 1 && pattern[0] == '^';
+            if (negate)
+                i++;
+            for (; i + 1 < size; i++) {
+                if (pattern[i] == '\\' && i + 2 < size)
+                    i++;
+                unsigned char first = pattern[i];
+                if (i + 3 < size && pattern[i + 1] == '-') {
+                    i += 2;
+                    if (pattern[i] == '\\' && i + 2 < size)
+                        i++;
+                    add(first, pattern[i]);
+                }
+                else
+                    add(first, first);
+            }
+            if (negate) {
+                for (auto &row: table)
+                    row = ~row;
+            }
+            std::copy_n(pattern, std::min(size - 1, sizeof(this->parser_name) - 1), this->parser_name);
+        }
+
+        constexpr parser_char_set(unsigned char first, unsigned char last) {
+            add(first, last);
+            this->parser_name[0] = first;
+            this->parser_name[1] = '-';
+            this->parser_name[2] = last;
+        }
+
+        template<typename Stream, typename GlobalState, typename State>
+        auto parse_impl(Stream& stream, GlobalState&, State&) const {
+            if(!this->peek_impl(stream)) {
+                this->error_handle_recovery(stream);
+                return std::optional<token_type>();
+            }
+            return std::make_optional(stream.Get());
+        }
+
+        template<typename Stream, typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState&, State&) const {
+            if(!this->peek_impl(stream)) {
+                this->error_handle_recovery(stream);
+                return false;
+            }
+            stream.Seek(1);
+            return true;
+        }
+
+        template<typename Stream>
+        bool peek_impl(Stream & stream) const {
+            return !stream.Eof() && contains(table, stream.Peek());
+        }
+
+        constexpr run_end run_stop() const {
+            return {table};
+        }
+
+        constexpr first_set first_set_impl() const {
+            first_set set;
+            set.known = true;
+            for (size_t key = 0; key < 256; key++) {
+                if (simd::class_contains(table, key))
+                    set = set | first_set::of(key);
+            }
+            return set;
+        }
+
+    private:
+        static constexpr bool contains(const uint8_t (&table)[32], const token_type &token) {
+            size_t key = first_key(token);
+            return key < 256 && simd::class_contains(table, key);
+        }
+
+        constexpr void add(unsigned char first, unsigned char last) {
+            for (unsigned c = first; c <= last; c++)
+                table[(c & 15) + ((c >> 7) << 4)] |= uint8_t(1) << ((c >> 4) & 7);
+        }
+
+        uint8_t table[32]{};
+    };
+
     template<typename token_type,typename return_type,typename buff_type,size_t buff_size,typename FF>
     class parser_buff_seq : public base_parser<token_type,parser_buff_seq<token_type,return_type,buff_type,buff_size,FF>> {
     public:
@@ -406,15 +830,35 @@ namespace pkuyo::parsers {
             stream.Seek(real_size);
             return std::make_optional(constructor(cmp));
         }
-        template<typename Stream>
-        bool peek_impl(Stream & stream) const {
-            for(int i = 0; i< real_size;i++) {
-                if(stream.Eof(i) || stream.Peek(i) != cmp[i]) {
-                    return false;
-                }
+
+        template<typename Stream, typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState&, State&) const {
+            if(!this->peek_impl(stream)) {
+                this->error_handle_recovery(stream);
+                return false;
             }
+            stream.Seek(real_size);
             return true;
         }
+        template<typename Stream>
+        bool peek_impl(Stream & stream) const {
+            return match_sequence(stream, cmp, real_size);
+        }
+
+        constexpr first_set first_set_impl() const {
+            if constexpr (has_first_key_v<token_type> && std::is_same_v<buff_type,token_type> && real_size > 0)
+                return first_set::of(first_key(cmp[0]));
+            else
+                return {};
+        }
+
+        template<size_t k>
+        constexpr auto prefix_impl() const {
+            if constexpr (std::is_same_v<buff_type,token_type>)
+                return prefix_set<token_type,k>::of(cmp, real_size);
+            else
+                return prefix_set<token_type,k>{};
+        }
 
         buff_type cmp[buff_size]{};
 
@@ -452,11 +896,25 @@ namespace pkuyo::parsers {
             return std::make_optional(std::move(result));
         }
 
+        template<typename Stream, typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState& global_state, State& state) const {
+            return recognize_then_impl(stream,global_state,state,std::make_index_sequence<std::tuple_size_v<children_parser_t>>());
+        }
+
         template<typename Stream>
         bool peek_impl(Stream & stream) const {
             return std::get<0>(children_parsers).peek_impl(stream);
         }
 
+        constexpr first_set first_set_impl() const {
+            return std::get<0>(children_parsers).first_set_impl();
+        }
+
+        template<size_t k>
+        constexpr auto prefix_impl() const {
+            return prefix_then_impl<k>(std::make_index_sequence<sizeof...(Parsers)>());
+        }
+
         void reset_impl() const {
             reset_then_impl(std::make_index_sequence<std::tuple_size_v<children_parser_t>>());
         }
@@ -499,6 +957,20 @@ namespace pkuyo::parsers {
             }
         }
 
+        template<typename Stream, typename GlobalState, typename State, size_t ...N>
+        bool recognize_then_impl(Stream& stream, GlobalState& global_state, State& state, std::index_sequence<N...>) const {
+            return (recognize_single<N>(stream,global_state,state) && ...);
+        }
+
+        template<size_t N, typename Stream, typename GlobalState, typename State>
+        bool recognize_single(Stream& stream, GlobalState& global_state, State& state) const {
+            if (!std::get<N>(children_parsers).recognize_impl(stream,global_state,state)) {
+                this->error_handle_recovery(stream);
+                return false;
+            }
+            return true;
+        }
+
         template<size_t ...N>
         void reset_then_impl(std::index_sequence<N...>) const{
             (std::get<N>(children_parsers).reset_impl(),...);
@@ -509,6 +981,13 @@ namespace pkuyo::parsers {
             (std::get<N>(children_parsers).no_error_internal(),...);
         }
 
+        template<size_t k, size_t first, size_t ...N>
+        constexpr auto prefix_then_impl(std::index_sequence<first, N...>) const {
+            auto set = std::get<first>(children_parsers).template prefix_impl<k>();
+            ((set = set.then(std::get<N>(children_parsers).template prefix_impl<k>())), ...);
+            return set;
+        }
+
         children_parser_t children_parsers;
 
     };
@@ -530,6 +1009,9 @@ namespace pkuyo::parsers {
     // A parser that queries and returns the result of the first sub-parser that satisfies the condition.
     // Note that it only predicts one token; backtracking for more than one token will result in a parser_exception.
     // The result_type is either the base class of each sub-parser or std::variant<types...>.
+    // When every sub-parser has a known first_set and the sets are pairwise disjoint, the constructor builds a
+    //  256-entry table from token to sub-parser, and parsing jumps straight to the only candidate instead of
+    //  peeking each alternative in turn.
     template <typename tuple,bool with_back_track>
     class parser_or;
     
@@ -539,12 +1021,25 @@ namespace pkuyo::parsers {
             parser_or<std::tuple<Parsers...>,with_back_track>> {
     public:
         using children_parser_t = std::tuple<Parsers...>;
-        constexpr parser_or(const children_parser_t &parsers) : children_parsers(parsers){}
+        using token_t = typename std::decay_t<std::tuple_element_t<0,std::tuple<Parsers...>>>::token_t;
+
+        constexpr parser_or(const children_parser_t &parsers) : children_parsers(parsers){
+            if constexpr (has_first_key_v<token_t> && sizeof...(Parsers) < 256)
+                build_dispatch(std::make_index_sequence<sizeof...(Parsers)>());
+        }
 
         template<typename Stream, typename GlobalState, typename State>
         auto parse_impl(Stream& stream, GlobalState& global_state, State& state) const {
             using result_t = multi_filter_or_t<children_parser_t,GlobalState,State>;
             std::optional<result_t> result;
+            if constexpr (has_first_key_v<token_t>) {
+                if (dispatchable) {
+                    // No alternative can start with a token outside the table, so every peek would fail.
+                    if (auto index = dispatch_index(stream))
+                        parse_dispatch(result,stream,global_state,state,index - 1,std::make_index_sequence<sizeof...(Parsers)>());
+                    return result;
+                }
+            }
             parse_or_impl(result,stream,global_state,state,std::make_index_sequence<std::tuple_size_v<children_parser_t>>());
             return result;
         }
@@ -587,25 +1082,147 @@ namespace pkuyo::parsers {
             }
         }
 
-        template<typename Stream>
-        bool peek_impl(Stream & stream) const {
-            return peek_or_impl(stream,std::make_index_sequence<std::tuple_size_v<children_parser_t >>());
-        }
-
-
-        void reset_impl() const {
-            reset_or_impl(std::make_index_sequence<std::tuple_size_v<children_parser_t>>());
+        template<typename Stream, typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState& global_state, State& state) const {
+            bool matched = false;
+            if constexpr (has_first_key_v<token_t>) {
+                if (dispatchable) {
+                    if (auto index = dispatch_index(stream))
+                        recognize_dispatch(matched,stream,global_state,state,index - 1,std::make_index_sequence<sizeof...(Parsers)>());
+                    return matched;
+                }
+            }
+            recognize_or_impl(matched,stream,global_state,state,std::make_index_sequence<sizeof...(Parsers)>());
+            return matched;
+        }
+
+        template<typename Stream>
+        bool peek_impl(Stream & stream) const {
+            if constexpr (has_first_key_v<token_t>) {
+                if (dispatchable) {
+                    auto index = dispatch_index(stream);
+                    return index && peek_dispatch(stream,index - 1,std::make_index_sequence<sizeof...(Parsers)>());
+                }
+            }
+            return peek_or_impl(stream,std::make_index_sequence<std::tuple_size_v<children_parser_t >>());
+        }
+
+        constexpr first_set first_set_impl() const {
+            return first_set_or_impl(std::make_index_sequence<sizeof...(Parsers)>());
+        }
+
+        template<size_t k>
+        constexpr auto prefix_impl() const {
+            return prefix_or_impl<k>(std::make_index_sequence<sizeof...(Parsers)>());
+        }
+
+
+        void reset_impl() const {
+            reset_or_impl(std::make_index_sequence<std::tuple_size_v<children_parser_t>>());
+        }
+
+        void no_error_impl() {
+            no_error_or_impl(std::make_index_sequence<std::tuple_size_v<children_parser_t>>());
+        }
+
+    private:
+
+        template<typename Stream, size_t ...N>
+        bool peek_or_impl(Stream & stream, std::index_sequence<N...>) const {
+            return (std::get<N>(children_parsers).peek_impl(stream) || ...);
+        }
+
+        template<size_t ...N>
+        constexpr first_set first_set_or_impl(std::index_sequence<N...>) const {
+            return (std::get<N>(children_parsers).first_set_impl() | ...);
+        }
+
+        template<size_t k, size_t ...N>
+        constexpr auto prefix_or_impl(std::index_sequence<N...>) const {
+            return (std::get<N>(children_parsers).template prefix_impl<k>() | ...);
+        }
+
+        template<size_t ...N>
+        constexpr void build_dispatch(std::index_sequence<N...>) {
+            first_set sets[] = {std::get<N>(children_parsers).first_set_impl()...};
+            for (size_t i = 0; i < sizeof...(N); i++) {
+                if (!sets[i].known)
+                    return;
+                for (size_t j = 0; j < i; j++)
+                    if (sets[i].intersects(sets[j]))
+                        return;
+            }
+            for (size_t i = 0; i < sizeof...(N); i++)
+                for (size_t key = 0; key < 256; key++)
+                    if (sets[i].contains(key))
+                        dispatch[key] = static_cast<uint8_t>(i + 1);
+            dispatchable = true;
+        }
+
+        // 1 + index of the only alternative that can start at the current token, or 0 if there is none.
+        template<typename Stream>
+        size_t dispatch_index(Stream & stream) const {
+            if (stream.Eof())
+                return 0;
+            auto key = first_key(stream.Peek());
+            return key < 256 ? dispatch[key] : 0;
+        }
+
+        template<typename Result, typename Stream, typename GlobalState, typename State, size_t ...N>
+        bool parse_dispatch(Result& result, Stream& stream, GlobalState& global_state, State& state,
+                            size_t index, std::index_sequence<N...>) const {
+            using single_t = bool (parser_or::*)(Result&, Stream&, GlobalState&, State&) const;
+            static constexpr single_t table[] = {&parser_or::parse_single<Result,Stream,GlobalState,State,N>...};
+            return (this->*table[index])(result,stream,global_state,state);
+        }
+
+        template<typename Stream, typename GlobalState, typename State, size_t ...N>
+        bool recognize_or_impl(bool& matched, Stream& stream, GlobalState& global_state, State& state,
+                               std::index_sequence<N...>) const {
+            return (recognize_single<Stream,GlobalState,State,N>(matched,stream,global_state,state) || ...);
+        }
+
+        // Mirrors `parse_single`: returns true once an alternative was chosen, `matched` tells whether it succeeded.
+        template<typename Stream, typename GlobalState, typename State, size_t N>
+        bool recognize_single(bool& matched, Stream& stream, GlobalState& global_state, State& state) const {
+            if (!std::get<N>(children_parsers).peek_impl(stream))
+                return false;
+
+            if constexpr (with_back_track) {
+                auto stream_state = stream.Save();
+                if (!std::get<N>(children_parsers).recognize_impl(stream, global_state, state)) {
+                    stream.Restore(stream_state);
+                    return false;
+                }
+            }
+            else {
+                if (!std::get<N>(children_parsers).recognize_impl(stream, global_state, state)) {
+                    this->error_handle_recovery(stream);
+                    return true;
+                }
+            }
+            matched = true;
+            return true;
+        }
+
+        template<typename Stream, typename GlobalState, typename State, size_t ...N>
+        bool recognize_dispatch(bool& matched, Stream& stream, GlobalState& global_state, State& state,
+                                size_t index, std::index_sequence<N...>) const {
+            using single_t = bool (parser_or::*)(bool&, Stream&, GlobalState&, State&) const;
+            static constexpr single_t table[] = {&parser_or::recognize_single<Stream,GlobalState,State,N>...};
+            return (this->*table[index])(matched,stream,global_state,state);
         }
 
-        void no_error_impl() {
-            no_error_or_impl(std::make_index_sequence<std::tuple_size_v<children_parser_t>>());
+        template<typename Stream, size_t ...N>
+        bool peek_dispatch(Stream & stream, size_t index, std::index_sequence<N...>) const {
+            using peek_t = bool (parser_or::*)(Stream&) const;
+            static constexpr peek_t table[] = {&parser_or::peek_single<Stream,N>...};
+            return (this->*table[index])(stream);
         }
 
-    private:
-
-        template<typename Stream, size_t ...N>
-        bool peek_or_impl(Stream & stream, std::index_sequence<N...>) const {
-            return (std::get<N>(children_parsers).peek_impl(stream) || ...);
+        template<typename Stream, size_t N>
+        bool peek_single(Stream & stream) const {
+            return std::get<N>(children_parsers).peek_impl(stream);
         }
 
         template<size_t ...N>
@@ -624,6 +1241,9 @@ namespace pkuyo::parsers {
     private:
         children_parser_t children_parsers;
 
+        bool dispatchable = false;
+        uint8_t dispatch[has_first_key_v<token_t> ? 256 : 1]{};
+
     };
 
     template<typename T>
@@ -636,6 +1256,57 @@ namespace pkuyo::parsers {
         }
     }
 
+    // A parser that predicts with up to `k` tokens of lookahead instead of its child's single-token peek,
+    //  so that a plain `Or` can choose between alternatives sharing a common prefix without backtracking.
+    //  The child's k-token prefix_set is computed when the parser is constructed; if it is unknown,
+    //  the child's own peek is used. Parsing is forwarded to the child unchanged.
+    template<size_t k, typename child_type>
+    class parser_lookahead : public base_parser<typename std::decay_t<child_type>::token_t, parser_lookahead<k,child_type>> {
+    public:
+        using token_t = typename std::decay_t<child_type>::token_t;
+
+        constexpr explicit parser_lookahead(const child_type & _child_parser)
+                : child_parser(_child_parser), prefixes(child_parser.template prefix_impl<k>()) {}
+
+        template<typename Stream, typename GlobalState, typename State>
+        auto parse_impl(Stream& stream, GlobalState& global_state, State& state) const {
+            return child_parser.parse_impl(stream,global_state,state);
+        }
+
+        template<typename Stream, typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState& global_state, State& state) const {
+            return child_parser.recognize_impl(stream,global_state,state);
+        }
+
+        template<typename Stream>
+        bool peek_impl(Stream & stream) const {
+            if (!prefixes.known)
+                return child_parser.peek_impl(stream);
+            return prefixes.match(stream);
+        }
+
+        void reset_impl() const {
+            child_parser.reset_impl();
+        }
+
+        void no_error_impl() {
+            child_parser.no_error_internal();
+        }
+
+        constexpr first_set first_set_impl() const {
+            return child_parser.first_set_impl();
+        }
+
+        template<size_t n>
+        constexpr auto prefix_impl() const {
+            return child_parser.template prefix_impl<n>();
+        }
+
+    private:
+        child_type child_parser;
+        prefix_set<token_t,k> prefixes;
+    };
+
     // Match the child parser 0 or more times, returning std::vector<child_return_type> (std::basic_string<child_return_type> for char or wchar_t).
     template<typename child_type>
     class parser_many : public base_parser<typename std::decay_t<child_type>::token_t,parser_many<child_type>> {
@@ -649,6 +1320,8 @@ namespace pkuyo::parsers {
 
             result_container_t<child_return_type> results;
             if constexpr(std::is_same_v<child_return_type,nullptr_t>) results = nullptr;
+            if constexpr (is_contiguous_stream_v<Stream> && requires { child_parser.run_stop(); })
+                skip_until(stream, child_parser.run_stop(), [&results](auto run) { results.insert(results.end(), run.begin(), run.end()); });
             while (!stream.Eof() && child_parser.peek_impl(stream)) {
                 auto result = child_parser.parse_impl(stream, global_state, state);
                 if (!result) {
@@ -661,6 +1334,19 @@ namespace pkuyo::parsers {
             return std::make_optional(std::move(results));
 
         }
+
+        template<typename Stream, typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState& global_state, State& state) const {
+            if constexpr (is_contiguous_stream_v<Stream> && requires { child_parser.run_stop(); })
+                skip_until(stream, child_parser.run_stop(), [](auto) {});
+            while (!stream.Eof() && child_parser.peek_impl(stream)) {
+                if (!child_parser.recognize_impl(stream, global_state, state)) {
+                    this->error_handle_recovery(stream);
+                    return false;
+                }
+            }
+            return true;
+        }
         template<typename Stream>
         bool peek_impl(Stream &) const {
             return true;
@@ -702,6 +1388,8 @@ namespace pkuyo::parsers {
             if constexpr(!std::is_same_v<child_return_type,nullptr_t>)
                 results.push_back(std::move(*first_result));
 
+            if constexpr (is_contiguous_stream_v<Stream> && requires { child_parser.run_stop(); })
+                skip_until(stream, child_parser.run_stop(), [&results](auto run) { results.insert(results.end(), run.begin(), run.end()); });
             while (!stream.Eof() && child_parser.peek_impl(stream)) {
                 auto result = child_parser.parse_impl(stream, global_state, state);
                 if (!result) {
@@ -715,6 +1403,23 @@ namespace pkuyo::parsers {
 
         }
 
+        template<typename Stream, typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState& global_state, State& state) const {
+            if (!child_parser.recognize_impl(stream, global_state, state)) {
+                this->error_handle_recovery(stream);
+                return false;
+            }
+            if constexpr (is_contiguous_stream_v<Stream> && requires { child_parser.run_stop(); })
+                skip_until(stream, child_parser.run_stop(), [](auto) {});
+            while (!stream.Eof() && child_parser.peek_impl(stream)) {
+                if (!child_parser.recognize_impl(stream, global_state, state)) {
+                    this->error_handle_recovery(stream);
+                    return false;
+                }
+            }
+            return true;
+        }
+
         template<typename Stream>
         bool peek_impl(Stream & stream) const {
             return child_parser.peek_impl(stream);
@@ -727,6 +1432,16 @@ namespace pkuyo::parsers {
         void no_error_impl() {
             child_parser.no_error_internal();
         }
+
+        constexpr first_set first_set_impl() const {
+            return child_parser.first_set_impl();
+        }
+
+        template<size_t k>
+        constexpr auto prefix_impl() const {
+            // Further repetitions may follow any match of the child.
+            return child_parser.template prefix_impl<k>().then({});
+        }
     private:
         child_type child_parser;
     };
@@ -756,6 +1471,17 @@ namespace pkuyo::parsers {
             return std::make_optional(std::move(results));
 
         }
+
+        template<typename Stream, typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState& global_state, State& state) const {
+            for (int i = 0; i<repeat_count;i++) {
+                if (!child_parser.recognize_impl(stream, global_state, state)) {
+                    this->error_handle_recovery(stream);
+                    return false;
+                }
+            }
+            return true;
+        }
         template<typename Stream>
         bool peek_impl(Stream & stream) const {
             return child_parser.peek_impl(stream);
@@ -798,6 +1524,14 @@ namespace pkuyo::parsers {
 
             return std::make_optional(std::move(result));
         }
+        template<typename Stream, typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState& global_state, State& state) const {
+            if(child_parser.peek_impl(stream) && !child_parser.recognize_impl(stream,global_state,state)) {
+                this->error_handle_recovery(stream);
+                return false;
+            }
+            return true;
+        }
 
         template<typename Stream>
         bool peek_impl(Stream &) const {
@@ -815,7 +1549,138 @@ namespace pkuyo::parsers {
     };
 
 
+    // A call of a Lazy rule that is being parsed or peeked at `start` of `stream`.
+    //  Used to detect a rule calling itself at the same position (direct left recursion).
+    //  Frames live on the call stack and are chained per rule (see left_recursion_top), so the check is O(1).
+    struct left_recursion_frame {
+        const void *stream;
+        size_t start;
+        size_t end;
+        bool success = false;
+        bool used = false;
+        const void *result_tag = nullptr;
+        const void *result = nullptr;
+        // Takes the snapshot growth restores to; called when the recursion is found (by a parse or a peek),
+        //  while the stream is at `start`.
+        void *origin = nullptr;
+        void (*save_origin)(void *origin, void *stream) = nullptr;
+        left_recursion_frame *previous = nullptr;
+    };
+
+    // Innermost active frame of the rule `rule_type` on this thread.
+    //  Starts along a rule's chain never decrease, so only the innermost frame can be at the current position.
+    template<typename rule_type>
+    left_recursion_frame *&left_recursion_top() {
+        thread_local left_recursion_frame *top = nullptr;
+        return top;
+    }
+
+    inline left_recursion_frame *find_left_recursion(left_recursion_frame *top, const void *stream, size_t start) {
+        if (top && top->stream == stream && top->start == start)
+            return top;
+        return nullptr;
+    }
+
+    // Runs `run` with `frame` linked as the innermost frame of the chain at `top`, and unlinks it again
+    //  before returning or rethrowing, so the thread-local chain never keeps the address of a finished call.
+    template<typename run_type>
+    auto with_left_recursion_frame(left_recursion_frame *&top, left_recursion_frame &frame, run_type &&run) {
+        frame.previous = top;
+        top = &frame;
+        try {
+            auto result = run();
+            top = frame.previous;
+            return result;
+        }
+        catch (...) {
+            top = frame.previous;
+            throw;
+        }
+    }
+
+    template<typename result_type>
+    struct left_recursion_result {
+        static constexpr char tag = 0;
+    };
+
+    template<typename Stream>
+    void save_left_recursion_origin(void *origin, void *stream) {
+        auto &slot = *static_cast<std::optional<decltype(std::declval<Stream &>().Save())> *>(origin);
+        if (!slot)
+            slot.emplace(static_cast<Stream *>(stream)->Save());
+    }
+
+    // Parses `body` as the definition of a rule whose active frames are chained at `top`, growing a seed for
+    //  direct left recursion (Warth et al., "Packrat Parsers Can Support Left Recursion"):
+    //  a call of the rule at the same position from within `body` first fails, so only the non-recursive
+    //  alternatives match; `body` is then re-parsed with the call replaying the previous result, for as
+    //  long as each round consumes more input. A round that fails ends the growth; errors are not reported
+    //  during growth rounds (see error_reporting_scope), so the final round neither throws nor logs.
+    //  The stream is only snapshotted once a recursive call is found, so rules that never left-recurse
+    //  do not pin buffered input. Results that cannot be copied are parsed without left recursion support.
+    template<typename body_type, typename Stream, typename GlobalState, typename State>
+    auto parse_left_recursive(left_recursion_frame *&top, const body_type &body, Stream &stream, GlobalState &global_state, State &state) {
+        using result_t = decltype(body.parse_impl(stream, global_state, state));
+        if constexpr (!std::is_copy_constructible_v<result_t>) {
+            return body.parse_impl(stream, global_state, state);
+        }
+        else {
+            size_t start = stream.Index();
+            if (auto frame = find_left_recursion(top, &stream, start)) {
+                frame->used = true;
+                if (frame->save_origin)
+                    frame->save_origin(frame->origin, &stream);
+                if (frame->result_tag != &left_recursion_result<result_t>::tag)
+                    return result_t();
+                result_t result = *static_cast<const result_t *>(frame->result);
+                if (result)
+                    stream.Seek(frame->end - start);
+                return result;
+            }
+
+            result_t best;
+            std::optional<decltype(stream.Save())> origin;
+            left_recursion_frame frame{&stream, start, start, false, false, &left_recursion_result<result_t>::tag, &best};
+            frame.origin = &origin;
+            frame.save_origin = &save_left_recursion_origin<Stream>;
+            return with_left_recursion_frame(top, frame, [&]() -> result_t {
+                auto result = body.parse_impl(stream, global_state, state);
+                if (!result || !frame.used || !origin || stream.Index() == start)
+                    return result;
+
+                while (result && stream.Index() > frame.end) {
+                    best = std::move(result);
+                    frame.end = stream.Index();
+                    frame.success = true;
+                    stream.Restore(*origin);
+                    error_reporting_scope quiet(false);
+                    result = body.parse_impl(stream, global_state, state);
+                }
+                stream.Restore(*origin);
+                stream.Seek(frame.end - start);
+                return best;
+            });
+        }
+    }
+
+    // Peeks `body` as the definition of a rule whose active frames are chained at `top`.
+    //  A left-recursive call predicts whether a seed has been found at this position, and never recurses.
+    template<typename body_type, typename Stream>
+    bool peek_left_recursive(left_recursion_frame *&top, const body_type &body, Stream &stream) {
+        size_t start = stream.Index();
+        if (auto frame = find_left_recursion(top, &stream, start)) {
+            frame->used = true;
+            if (frame->save_origin)
+                frame->save_origin(frame->origin, &stream);
+            return frame->success;
+        }
+        left_recursion_frame frame{&stream, start, start};
+        return with_left_recursion_frame(top, frame, [&] { return body.peek_impl(stream); });
+    }
+
+
     // Lazy initialization parser to resolve recursive dependencies between parsers.
+    //  Direct left recursion (the rule calling itself before consuming input) is supported, see parse_left_recursive.
     // No error recovery.
     template <typename token_type, typename real_type>
     class parser_lazy : public base_parser<token_type,parser_lazy<token_type,real_type>> {
@@ -823,12 +1688,12 @@ namespace pkuyo::parsers {
 
         template<typename Stream>
         bool peek_impl(Stream & stream) const {
-            return factory().peek_impl(stream);
+            return peek_left_recursive(left_recursion_top<parser_lazy>(), factory(), stream);
         }
 
         template<typename Stream, typename GlobalState, typename State>
         auto parse_impl(Stream& stream, GlobalState& global_state, State& state) const {
-            return factory().parse_impl(stream,global_state,state);
+            return parse_left_recursive(left_recursion_top<parser_lazy>(), factory(), stream, global_state, state);
         }
     private:
         static real_type& factory() {
@@ -840,6 +1705,7 @@ namespace pkuyo::parsers {
 
 #if !defined(__GNUC__)  || defined(__clang__)
 
+    // Self-referencing Lazy built from a generator. Left recursion is not supported here (see parser_lazy).
     template<typename token_type,typename return_type, typename Generator>
     struct parser_auto_lazy : public base_parser<token_type, parser_auto_lazy<token_type,return_type, Generator>> {
         struct Proxy;
@@ -955,6 +1821,22 @@ namespace pkuyo::parsers {
             }
         }
 
+        // Under `Validate` without states the mapper only builds the discarded value, so it is skipped.
+        //  Everywhere else (e.g. under `-parser`) it runs, since it may have side effects or throw.
+        template<typename Stream,typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState& global_state, State& state) const {
+            if constexpr (std::is_same_v<GlobalState, nullptr_t> && std::is_same_v<State, nullptr_t>) {
+                if (validating()) {
+                    if (!source.recognize_impl(stream, global_state, state)) {
+                        this->error_handle_recovery(stream);
+                        return false;
+                    }
+                    return true;
+                }
+            }
+            return parse_impl(stream, global_state, state).has_value();
+        }
+
 
         template<typename Stream>
         bool peek_impl(Stream & stream) const {
@@ -969,6 +1851,15 @@ namespace pkuyo::parsers {
         void no_error_impl() {
             source.no_error_internal();
         }
+
+        constexpr first_set first_set_impl() const {
+            return source.first_set_impl();
+        }
+
+        template<size_t k>
+        constexpr auto prefix_impl() const {
+            return source.template prefix_impl<k>();
+        }
     private:
         child_type source;
         mapper_t mapper;
@@ -1047,6 +1938,15 @@ namespace pkuyo::parsers {
         void no_error_impl() {
             source.no_error_internal();
         }
+
+        constexpr first_set first_set_impl() const {
+            return source.first_set_impl();
+        }
+
+        template<size_t k>
+        constexpr auto prefix_impl() const {
+            return source.template prefix_impl<k>();
+        }
     private:
         child_type source;
         action_t action;
@@ -1114,6 +2014,15 @@ namespace pkuyo::parsers {
         void no_error_impl() {
             child_parser.no_error_internal();
         }
+
+        constexpr first_set first_set_impl() const {
+            return child_parser.first_set_impl();
+        }
+
+        template<size_t k>
+        constexpr auto prefix_impl() const {
+            return child_parser.template prefix_impl<k>();
+        }
     private:
         child_type child_parser;
         Predicate predicate;
@@ -1131,6 +2040,11 @@ namespace pkuyo::parsers {
             return parser.parse_impl(stream,global_state, factory());
         }
 
+        template<typename Stream, typename GlobalState, typename LastState>
+        bool recognize_impl(Stream& stream,GlobalState& global_state, LastState&) const {
+            return parser.recognize_impl(stream,global_state, factory());
+        }
+
         template<typename Stream>
         bool peek_impl(Stream& stream) const {
             return parser.peek_impl(stream);
@@ -1169,7 +2083,24 @@ namespace pkuyo::parsers {
                 return recovery.parse_impl(stream, global_state, state);
             }
 
-            try {
+            // Without exceptions, a failure recorded by `parser` takes the place of the caught parser_exception.
+            //  `on_error` is called with the parse_error if it accepts one.
+            //  Errors of `parser` are reported even inside a left-recursion growth round, so that they are recovered here.
+            if constexpr (stream_error_policy_v<Stream> == error_policy::status) {
+                bool failed_before = stream.Failed();
+                auto result = [&] {
+                    error_reporting_scope reporting(true);
+                    return parser.parse_impl(stream, global_state, state);
+                }();
+                if (failed_before || !stream.Failed())
+                    return result;
+                if constexpr (std::is_invocable_v<const OnError&, const parse_error&, GlobalState&>)
+                    on_error(stream.Error(), global_state);
+                stream.ClearError();
+                return recovery.parse_impl(stream, global_state, state);
+            }
+            else try {
+                error_reporting_scope reporting(true);
                 return parser.parse_impl(stream, global_state, state);
             } catch (const parser_exception& ex) {
 
@@ -1197,6 +2128,255 @@ namespace pkuyo::parsers {
         Recovery recovery;
     };
 
+    // Packrat memoization of a child parser.
+    //  Results are cached per token index (see `Stream::Index()`), so a rule tried again at the same position
+    //  (e.g. by another alternative of `Or_BackTrack`) replays its outcome instead of re-parsing:
+    //  a success seeks past the consumed tokens and returns a copy of the cached result, a failure fails immediately.
+    //  Results that are not copyable (e.g. unique_ptr) only have their failures cached.
+    //  The cache is a per-parse table of this thread keyed by the parser's address (see `parse_caches`), so the
+    //  parser stays a literal type; it is dropped when the outermost `Parse` / `Validate` returns and when a
+    //  different stream is parsed. Copies of a Memo parser have separate caches: to share one between several
+    //  call sites, define the memoized rule once and refer to it through `Lazy`.
+    //  Assumes the child's result depends only on the input, not on the states.
+    template<typename child_type>
+    class parser_memo : public base_parser<typename std::decay_t<child_type>::token_t, parser_memo<child_type>> {
+        template<typename result_type>
+        struct table : parse_cache_base {
+            struct entry {
+                bool success;
+                size_t end_index;
+                std::optional<result_type> value;
+            };
+
+            static constexpr char tag = 0;
+
+            explicit table(uint32_t _stream_id) : parse_cache_base(&tag), stream_id(_stream_id) {}
+
+            uint32_t stream_id;
+            std::pmr::monotonic_buffer_resource arena;
+            std::pmr::unordered_map<size_t, entry> entries{&arena};
+        };
+
+    public:
+        constexpr explicit parser_memo(const child_type &_child_parser) : child_parser(_child_parser) {}
+
+        constexpr explicit parser_memo(child_type &&_child_parser) : child_parser(std::move(_child_parser)) {}
+
+        template<typename Stream, typename GlobalState, typename State>
+        auto parse_impl(Stream &stream, GlobalState &global_state, State &state) const {
+            using result_type = typename decltype(child_parser.parse_impl(stream, global_state, state))::value_type;
+            using table_type = table<result_type>;
+            constexpr bool cache_success = std::is_copy_constructible_v<result_type>;
+
+            // Slots are never erased during a parse, and references into the map survive insertions.
+            auto &slot = parse_caches()[this];
+            auto stream_id = stream.Position().stream_id;
+            if (!slot || slot->type_tag != &table_type::tag || static_cast<table_type *>(slot.get())->stream_id != stream_id)
+                slot = std::make_unique<table_type>(stream_id);
+            auto *cache = static_cast<table_type *>(slot.get());
+
+            size_t start = stream.Index();
+            if (auto it = cache->entries.find(start); it != cache->entries.end()) {
+                if (!it->second.success) {
+                    this->error_handle_recovery(stream);
+                    return std::optional<result_type>();
+                }
+                if constexpr (cache_success) {
+                    stream.Seek(it->second.end_index - start);
+                    return it->second.value;
+                }
+            }
+
+            auto result = child_parser.parse_impl(stream, global_state, state);
+            if (!result)
+                cache->entries.try_emplace(start, false, start, std::nullopt);
+            else if constexpr (cache_success)
+                cache->entries.try_emplace(start, true, stream.Index(), result);
+            return result;
+        }
+
+        template<typename Stream>
+        bool peek_impl(Stream &stream) const {
+            return child_parser.peek_impl(stream);
+        }
+
+        void reset_impl() const {
+            child_parser.reset_impl();
+        }
+
+        void no_error_impl() {
+            child_parser.no_error_internal();
+        }
+
+        constexpr first_set first_set_impl() const {
+            return child_parser.first_set_impl();
+        }
+
+        template<size_t k>
+        constexpr auto prefix_impl() const {
+            return child_parser.template prefix_impl<k>();
+        }
+
+    private:
+        child_type child_parser;
+    };
+
+    enum class pratt_kind { prefix, postfix, infix_left, infix_right };
+
+    // An entry of the operator table of parser_pratt. `op` matches the operator, `precedence` is its binding power
+    //  (higher binds tighter) and `fold` combines the operands as soon as they are parsed:
+    //  `fold(operand)` for prefix and postfix operators, `fold(lhs, rhs)` for infix operators.
+    //  The result of `op` itself is discarded.
+    template<pratt_kind kind_value, typename op_type, typename FF>
+    struct pratt_operator {
+        static constexpr pratt_kind kind = kind_value;
+
+        op_type op;
+        int precedence;
+        FF fold;
+    };
+
+    // A precedence-climbing (Pratt) parser for expressions made of `operand`s and the operators of a table.
+    //  An operator is recognised by the first table entry whose `op` peeks successfully: prefix entries before
+    //  an operand, postfix and infix entries after one. Postfix and infix operators bind while their precedence
+    //  is at least the current minimum; the right-hand side of an infix operator is parsed with a higher minimum
+    //  (left associative) or the same one (right associative). Folds run in a single loop per operand,
+    //  without intermediate containers. Returns the result type of `operand`.
+    template<typename operand_type, typename operators_type>
+    class parser_pratt;
+
+    template<typename operand_type, typename ...Operators>
+    class parser_pratt<operand_type, std::tuple<Operators...>>
+            : public base_parser<typename std::decay_t<operand_type>::token_t, parser_pratt<operand_type, std::tuple<Operators...>>> {
+    public:
+        using operators_t = std::tuple<Operators...>;
+
+        constexpr parser_pratt(const operand_type &_operand, const operators_t &_operators)
+                : operand(_operand), operators(_operators) {}
+
+        template<typename Stream, typename GlobalState, typename State>
+        auto parse_impl(Stream& stream, GlobalState& global_state, State& state) const {
+            return parse_expression(stream, global_state, state, 0);
+        }
+
+        template<typename Stream>
+        bool peek_impl(Stream & stream) const {
+            return operand.peek_impl(stream) ||
+                   with_next_operator<true>(stream, [](const auto &) {}, std::index_sequence_for<Operators...>());
+        }
+
+        void reset_impl() const {
+            operand.reset_impl();
+            std::apply([](const auto &...entry) { (entry.op.reset_impl(), ...); }, operators);
+        }
+
+        void no_error_impl() {
+            operand.no_error_internal();
+            std::apply([](auto &...entry) { (entry.op.no_error_internal(), ...); }, operators);
+        }
+
+        constexpr first_set first_set_impl() const {
+            return std::apply([this](const auto &...entry) {
+                return (operand.first_set_impl() | ... | prefix_first_set(entry));
+            }, operators);
+        }
+
+    private:
+        template<typename Stream, typename GlobalState, typename State>
+        auto parse_expression(Stream& stream, GlobalState& global_state, State& state, int min_precedence) const
+                -> decltype(std::declval<const operand_type &>().parse_impl(stream, global_state, state)) {
+            using result_t = decltype(operand.parse_impl(stream, global_state, state));
+            constexpr auto indices = std::index_sequence_for<Operators...>();
+            result_t lhs;
+            bool failed = false;
+
+            bool prefixed = with_next_operator<true>(stream, [&](const auto &entry) {
+                if (!entry.op.parse_impl(stream, global_state, state)) {
+                    failed = true;
+                    return;
+                }
+                auto rhs = parse_expression(stream, global_state, state, entry.precedence);
+                if (!rhs) {
+                    failed = true;
+                    return;
+                }
+                lhs.emplace(entry.fold(std::move(*rhs)));
+            }, indices);
+            if (failed)
+                return result_t();
+            if (!prefixed) {
+                lhs = operand.parse_impl(stream, global_state, state);
+                if (!lhs) {
+                    this->error_handle_recovery(stream);
+                    return lhs;
+                }
+            }
+
+            while (true) {
+                bool bound = false;
+                with_next_operator<false>(stream, [&](const auto &entry) {
+                    using entry_t = std::decay_t<decltype(entry)>;
+                    if (entry.precedence < min_precedence)
+                        return;
+                    bound = true;
+                    if (!entry.op.parse_impl(stream, global_state, state)) {
+                        failed = true;
+                        return;
+                    }
+                    if constexpr (entry_t::kind == pratt_kind::postfix) {
+                        *lhs = entry.fold(std::move(*lhs));
+                    }
+                    else {
+                        int next_precedence = entry_t::kind == pratt_kind::infix_left ? entry.precedence + 1 : entry.precedence;
+                        auto rhs = parse_expression(stream, global_state, state, next_precedence);
+                        if (!rhs) {
+                            failed = true;
+                            return;
+                        }
+                        *lhs = entry.fold(std::move(*lhs), std::move(*rhs));
+                    }
+                }, indices);
+                if (failed)
+                    return result_t();
+                if (!bound)
+                    return lhs;
+            }
+        }
+
+        // Calls `handler(entry)` for the first prefix (or non-prefix) entry whose `op` peeks; false if there is none.
+        template<bool prefix, typename Stream, typename Handler, size_t ...N>
+        bool with_next_operator(Stream &stream, Handler &&handler, std::index_sequence<N...>) const {
+            return (try_operator<prefix, N>(stream, handler) || ...);
+        }
+
+        template<bool prefix, size_t N, typename Stream, typename Handler>
+        bool try_operator(Stream &stream, Handler &handler) const {
+            const auto &entry = std::get<N>(operators);
+            if constexpr ((std::decay_t<decltype(entry)>::kind == pratt_kind::prefix) != prefix)
+                return false;
+            else {
+                if (!entry.op.peek_impl(stream))
+                    return false;
+                handler(entry);
+                return true;
+            }
+        }
+
+        template<typename entry_type>
+        static constexpr first_set prefix_first_set(const entry_type &entry) {
+            if constexpr (entry_type::kind == pratt_kind::prefix)
+                return entry.op.first_set_impl();
+            else {
+                first_set set;
+                set.known = true;
+                return set;
+            }
+        }
+
+        operand_type operand;
+        operators_t operators;
+    };
+
     template <typename token_type,bool is_after_this,typename FF,typename return_type = nullptr_t>
     class sync_point_recovery_parser : public base_parser<token_type,sync_point_recovery_parser<token_type,is_after_this,FF,return_type>> {
     public:
@@ -1204,6 +2384,8 @@ namespace pkuyo::parsers {
 
         template<typename Stream, typename GlobalState, typename State>
         auto parse_impl(Stream& stream, GlobalState&, State&) const {
+            if constexpr (is_contiguous_stream_v<Stream>)
+                skip_until(stream, sync_func, [](auto) {});
             while(!sync_func(stream.Peek()) && !stream.Eof())
                 stream.Seek(1);
 
@@ -1256,6 +2438,13 @@ namespace pkuyo::parsers {
         return parser_str<token_type,size>(str);
     }
 
+    // Keywords("true", "false", "null") returns 0, 1 or 2 for the longest keyword at the cursor.
+    template<typename token_type = char, size_t ...sizes>
+    requires (sizeof...(sizes) > 0)
+    constexpr auto Keywords(const char (&...words)[sizes]) {
+        return parser_keywords<token_type, 1 + ((sizes - 1) + ...)>(words...);
+    }
+
     template<typename token_type, typename cmp_type = token_type,typename return_type = token_type>
     requires weakly_equality_comparable_with<token_type, cmp_type>
     constexpr auto SingleValue(cmp_type && cmp_value) {
@@ -1350,6 +2539,51 @@ namespace pkuyo::parsers {
 
 #endif
 
+    // Creates a packrat-memoized parser_memo around `child`.
+    template<typename child_type>
+    requires is_parser<child_type>
+    constexpr auto Memo(child_type && child) {
+        return parser_memo<std::remove_reference_t<child_type>>(std::forward<child_type>(child));
+    }
+
+    template<typename op_type, typename FF>
+    requires is_parser<op_type>
+    constexpr auto Prefix(op_type && op, int precedence, FF fold) {
+        return pratt_operator<pratt_kind::prefix, std::decay_t<op_type>, FF>{std::forward<op_type>(op), precedence, fold};
+    }
+
+    template<typename op_type, typename FF>
+    requires is_parser<op_type>
+    constexpr auto Postfix(op_type && op, int precedence, FF fold) {
+        return pratt_operator<pratt_kind::postfix, std::decay_t<op_type>, FF>{std::forward<op_type>(op), precedence, fold};
+    }
+
+    template<typename op_type, typename FF>
+    requires is_parser<op_type>
+    constexpr auto InfixLeft(op_type && op, int precedence, FF fold) {
+        return pratt_operator<pratt_kind::infix_left, std::decay_t<op_type>, FF>{std::forward<op_type>(op), precedence, fold};
+    }
+
+    template<typename op_type, typename FF>
+    requires is_parser<op_type>
+    constexpr auto InfixRight(op_type && op, int precedence, FF fold) {
+        return pratt_operator<pratt_kind::infix_right, std::decay_t<op_type>, FF>{std::forward<op_type>(op), precedence, fold};
+    }
+
+    // Creates a parser_pratt over `operand` with the operators built by Prefix/Postfix/InfixLeft/InfixRight.
+    template<typename operand_type, typename ...Operators>
+    requires is_parser<operand_type>
+    constexpr auto Pratt(operand_type && operand, Operators &&...operators) {
+        return parser_pratt<std::remove_reference_t<operand_type>, std::tuple<std::decay_t<Operators>...>>
+                (std::forward<operand_type>(operand), std::make_tuple(std::forward<Operators>(operators)...));
+    }
+
+    template<size_t k, typename child_type>
+    requires is_parser<child_type>
+    constexpr auto LookAhead(child_type && child) {
+        return parser_lookahead<k,std::remove_reference_t<child_type>>(std::forward<child_type>(child));
+    }
+
     template<typename child_type>
     requires is_parser<child_type>
     constexpr auto Optional(child_type && child) {
@@ -1414,6 +2648,15 @@ namespace pkuyo::parsers {
         return Or_BackTrack(Or_BackTrack(left,right),arg...);
     }
 
+    // An `Or` whose alternatives are each predicted with `k` tokens of lookahead (see parser_lookahead).
+    template<size_t k,typename l,typename r,typename ...args>
+    constexpr auto Or_LL(l&& left,r&& right, args&&... arg) {
+        if constexpr (sizeof...(args) == 0)
+            return Or(LookAhead<k>(std::forward<l>(left)),LookAhead<k>(std::forward<r>(right)));
+        else
+            return Or(LookAhead<k>(std::forward<l>(left)),Or_LL<k>(std::forward<r>(right),std::forward<args>(arg)...));
+    }
+
     template<typename l,typename r>
     requires std::is_same_v<typename std::remove_reference_t<l>::token_t,typename std::remove_reference_t<r>::token_t> && is_parser<l> && is_parser<r>
     constexpr auto Then(l&& left, r&& right) {
@@ -1427,6 +2670,22 @@ namespace pkuyo::parsers {
         return parser_ignore<std::remove_reference_t<child_type>>(std::forward<child_type>(child));
     }
 
+    template<typename token_type = char, size_t size>
+    constexpr auto CharSet(const char (&pattern)[size]) {
+        return parser_char_set<token_type>(pattern);
+    }
+
+    template<typename token_type = char>
+    constexpr auto CharSet(unsigned char first, unsigned char last) {
+        return parser_char_set<token_type>(first, last);
+    }
+
+    template<typename child_type>
+    requires is_parser<child_type>
+    constexpr auto Capture(child_type && child) {
+        return parser_capture<std::remove_reference_t<child_type>>(std::forward<child_type>(child));
+    }
+
     template<typename State,typename Parser>
     constexpr auto WithState(Parser&& parser) {
         return state_parser<Parser, State>(std::forward<Parser>(parser));
@@ -1461,7 +2720,7 @@ namespace pkuyo::parsers {
     template<typename token_type,bool is_after_this = false,typename cmp_type = token_type, typename return_type = nullptr_t>
     requires (weakly_equality_comparable_with<token_type, cmp_type>)
     constexpr auto Sync(token_type&& sync_point) {
-        auto ff = [sync_point](const token_type& token) {return token == sync_point;};
+        auto ff = token_equal<token_type>{sync_point};
         return sync_point_recovery_parser<token_type,is_after_this, decltype(ff),return_type>(std::move(ff));
     }
 }
@@ -20,6 +20,7 @@
 #include <functional>
 #include <format>
 #include <optional>
+#include <version>
 
 #include"traits.h"
 
@@ -58,10 +59,11 @@ namespace pkuyo::parsers {
         friend class _abstract_parser;
 
     public:
+        // `token_value` and `token_pos` are rendered lazily; call `str()` (or convert to std::string) to format them.
         typedef void(*error_handler_t)( const _abstract_parser<token_type> & parser,
                                         const std::optional<token_type> & token,
-                                        const std::string & token_value,
-                                        const std::string & token_pos,
+                                        const lazy_text & token_value,
+                                        const lazy_text & token_pos,
                                         const std::string_view & stream_name);
 
     public:
@@ -80,12 +82,24 @@ namespace pkuyo::parsers {
     std::function<std::remove_pointer_t<typename parser_error_handler<token_type>::error_handler_t>>
             parser_error_handler<token_type>::error_handler([](const _abstract_parser<token_type> & parser,
                                                                const std::optional<token_type> & token,
-                                                               const std::string & token_value,
-                                                               const std::string & token_pos,
+                                                               const lazy_text & token_value,
+                                                               const lazy_text & token_pos,
                                                                const std::string_view & stream_name) {
-            throw parser_exception(parser.Name(),token_value,token_pos,stream_name);
+            throw parser_exception(parser.Name(),token_value.str(),token_pos.str(),stream_name);
     });
 
 
 }
+#if defined(__cpp_lib_format)
+
+// Allows lazily rendered diagnostics to be passed to std::format directly.
+template<>
+struct std::formatter<pkuyo::parsers::lazy_text, char> : std::formatter<std::string, char> {
+    auto format(const pkuyo::parsers::lazy_text &text, std::format_context &ctx) const {
+        return std::formatter<std::string, char>::format(text.str(), ctx);
+    }
+};
+
+#endif
+
 #endif //LIGHT_PARSER_ERROR_HANDLER_H
@@ -0,0 +1,190 @@
+// incremental_parser.h
+/**
+ * @file incremental_parser.h
+ * @brief Coroutine-based driver for parsing input that arrives in chunks through a push_stream.
+ * @author pkuyo
+ * @date 2025-02-08
+ * @copyright Copyright (c) 2025 pkuyo. All rights reserved.
+ *
+ * Includes:
+ * - Resumable parse session yielding one result per record (incremental_parse)
+ * - Session factory ParseIncremental
+ */
+
+#ifndef LIGHT_PARSER_INCREMENTAL_PARSER_H
+#define LIGHT_PARSER_INCREMENTAL_PARSER_H
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+
+#include "base_parser.h"
+
+namespace pkuyo::parsers {
+
+    // A resumable parse session over a push_stream, produced by `ParseIncremental`.
+    //  `Next()` runs the session until a record is parsed (returns true, see `Value()`),
+    //  or until it suspends because the input received so far is not enough (`NeedsInput()`),
+    //  or until the input is exhausted (`Done()`). Exceptions thrown by the parser are rethrown from `Next()`.
+    template<typename result_type>
+    class incremental_parse {
+    public:
+        struct promise_type {
+            std::optional<result_type> value;
+            std::exception_ptr exception;
+            bool waiting = false;
+            bool failed = false;
+
+            incremental_parse get_return_object() {
+                return incremental_parse(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            std::suspend_always final_suspend() noexcept { return {}; }
+
+            std::suspend_always yield_value(result_type result) {
+                value.emplace(std::move(result));
+                return {};
+            }
+
+            void return_void() {}
+
+            void unhandled_exception() {
+                exception = std::current_exception();
+            }
+        };
+
+        // Awaited by the session when the stream ran dry in the middle of a record.
+        struct input_awaiter {
+            bool await_ready() const noexcept { return false; }
+
+            void await_suspend(std::coroutine_handle<promise_type> handle) const noexcept {
+                handle.promise().waiting = true;
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        // Awaited by the session before it stops on a record that failed to parse. Does not suspend.
+        struct failure_awaiter {
+            bool await_ready() const noexcept { return false; }
+
+            bool await_suspend(std::coroutine_handle<promise_type> handle) const noexcept {
+                handle.promise().failed = true;
+                return false;
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        incremental_parse(incremental_parse &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+        incremental_parse(const incremental_parse &) = delete;
+        incremental_parse &operator=(const incremental_parse &) = delete;
+
+        ~incremental_parse() {
+            if (handle)
+                handle.destroy();
+        }
+
+        // Resumes the session. Returns true when a new result is available through `Value()`.
+        bool Next() {
+            if (handle.done())
+                return false;
+            auto &promise = handle.promise();
+            promise.value.reset();
+            promise.waiting = false;
+            handle.resume();
+            if (promise.exception)
+                std::rethrow_exception(std::exchange(promise.exception, nullptr));
+            return promise.value.has_value();
+        }
+
+        result_type &Value() {
+            return *handle.promise().value;
+        }
+
+        // The session is suspended until more input is fed to the stream.
+        [[nodiscard]] bool NeedsInput() const {
+            return !handle.done() && handle.promise().waiting;
+        }
+
+        // The input is exhausted, or a record failed to parse (see `Failed()`).
+        [[nodiscard]] bool Done() const {
+            return handle.done();
+        }
+
+        // A record failed to parse without throwing; the session stopped at its first token.
+        [[nodiscard]] bool Failed() const {
+            return handle.promise().failed;
+        }
+
+    private:
+        explicit incremental_parse(std::coroutine_handle<promise_type> _handle) : handle(_handle) {}
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+
+    // Parses consecutive records from `stream` with `parser`, yielding each result as soon as its input has arrived.
+    //  Until the input is finished, each record is first recognized with `Validate` (stateless mappers do not run)
+    //  and only parsed with `Parse` once it is complete, so its mappers run exactly once.
+    //  When a record needs tokens that have not been fed yet, the session rewinds to the start of that record and
+    //  suspends until the tokens it stopped at have been fed (or the input is finished), then retries it.
+    //  Consumed records are discarded from the stream.
+    //  Each retry recognizes the record again from its start, so a record whose input arrives in N chunks, each one
+    //  reaching just past the previous stop, costs O(N) passes over the prefix (O(N^2) tokens). Feed large records
+    //  in larger chunks, or keep records small relative to the chunk size.
+    template<typename parser_type, typename token_type>
+    auto ParseIncremental(parser_type parser, push_stream<token_type> &stream)
+            -> incremental_parse<typename decltype(parser.Parse(stream))::value_type> {
+        using result_type = typename decltype(parser.Parse(stream))::value_type;
+        using session_type = incremental_parse<result_type>;
+
+        while (true) {
+            stream.Discard();
+            if (stream.Available() == 0) {
+                if (stream.Finished())
+                    co_return;
+                co_await typename session_type::input_awaiter{};
+                continue;
+            }
+
+            auto start = stream.Save();
+            size_t available = stream.Available();
+            std::optional<result_type> result;
+            bool starved = false;
+            size_t required = 0;
+            try {
+                // Once the input is finished no read can starve, so the record is parsed directly.
+                if (stream.Finished() || parser.Validate(stream)) {
+                    stream.Restore(start);
+                    result = parser.Parse(stream);
+                }
+            } catch (const need_more_input &e) {
+                starved = true;
+                required = e.Required();
+            }
+
+            if (starved) {
+                stream.Restore(start);
+                // Retrying before the missing tokens arrive would stop at the same read again.
+                do {
+                    co_await typename session_type::input_awaiter{};
+                } while (!stream.Finished() && stream.Index() + stream.Available() < required);
+                continue;
+            }
+            // A record that consumes nothing would be yielded forever.
+            if (!result || stream.Available() == available) {
+                stream.Restore(start);
+                co_await typename session_type::failure_awaiter{};
+                co_return;
+            }
+            co_yield std::move(*result);
+        }
+    }
+
+}
+
+#endif //LIGHT_PARSER_INCREMENTAL_PARSER_H
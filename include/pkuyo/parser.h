@@ -12,6 +12,7 @@
  * - Error handling mechanisms error_handler.h
  * - Runtime parsers runtime_parser.h
  * - Compile-time parsers compiler_time_parser.h
+ * - Incremental parse driver incremental_parser.h
  * 
  */
 
@@ -23,6 +24,7 @@
 #include "runtime_parser.h"
 #include "token_stream.h"
 #include "compile_time_parser.h"
+#include "incremental_parser.h"
 
 
 #endif //LIGHT_PARSER_PARSER_H
@@ -7,8 +7,9 @@
  * @copyright Copyright (c) 2025 pkuyo. All rights reserved.
  *
  * Includes:
- * - Regular expression parser parser_regex
+ * - Regular expression parser parser_regex (lazily built DFA)
  * - Dynamic sequence checking parser parser_multi_check
+ * - Dynamic keyword set parser parser_multi_keywords
  * - Runtime sequence construction parsers (VALUE/PTR)
  */
 
@@ -17,7 +18,11 @@
 #define LIGHT_PARSER_RUNTIME_PARSER_H
 #include "base_parser.h"
 #include "compile_time_parser.h"
-#include <regex>
+#include <array>
+#include <bitset>
+#include <cctype>
+#include <map>
+#include <stdexcept>
 
 namespace pkuyo::parsers {
     // A parser that matches tokens.
@@ -45,13 +50,18 @@ namespace pkuyo::parsers {
 
         template<typename Stream>
         bool peek_impl(Stream & stream) const {
-            int index = 0;
-            for(const auto & it : expected_seq) {
-                if(stream.Eof(index) || stream.Peek(index) != it)
-                    return false;
-                index++;
+            if constexpr (std::ranges::contiguous_range<sequence_type>) {
+                return match_sequence(stream, std::ranges::data(expected_seq), std::ranges::size(expected_seq));
+            }
+            else {
+                int index = 0;
+                for(const auto & it : expected_seq) {
+                    if(stream.Eof(index) || stream.Peek(index) != it)
+                        return false;
+                    index++;
+                }
+                return true;
             }
-            return true;
 
         }
 
@@ -61,56 +71,566 @@ namespace pkuyo::parsers {
     };
 
 
-    // A parser class that uses regular expressions for comparison.
-    //This class is primarily used to parse and compare input strings using regular expressions.
-    // During prediction, the length of the input string is controlled by the `pred_count` parameter, which defaults to 1.
-//    template<typename token_type,size_t pred_count>
-//    class parser_regex : public base_parser<token_type, parser_regex<token_type,pred_count>> {
-//
-//    public:
-//
-//        explicit parser_regex(const std::string _pattern)
-//                : pattern(_pattern),
-//                  regex(_pattern, std::regex_constants::ECMAScript | std::regex_constants::optimize)
-//        {
-//            // Compile the regular expression, throw an exception if it fails
-//            if (!regex.flags()) {
-//                throw std::runtime_error("Invalid regex pattern: " + pattern);
-//            }
-//        }
-//
-//        template<typename Stream>
-//        bool peek_impl(Iter it, Iter end) const {
-//            if (it == end) return false;
-//            std::match_results<Iter> match;
-//            return std::regex_search(it, std::next(it, pred_count), match, regex);
-//        }
-//
-//
-//        template<typename Stream>
-//        auto parse_impl(Stream & stream) const {
-//
-//            auto start = it;
-//            std::string candidate(start, end); // Create a string of the remaining input
-//            std::smatch match;
-//
-//            // Perform the regex match (must match continuously from the beginning)
-//            if (std::regex_search(candidate, match, regex,
-//                                  std::regex_constants::match_continuous))
-//            {
-//                size_t length = match.length(); // Get the length of the match
-//                std::advance(it, length);       // Move the iterator forward
-//                return std::make_optional(std::string(start, it));  // Return the matched string
-//            } else {
-//                this->error_handle_recovery(stream);
-//                return std::optional<std::string>();
-//            }
-//        }
-//
-//    private:
-//        std::string pattern;
-//        std::regex regex;
-//    };
+    // A parser that matches the longest of a keyword set given at runtime, returning its index in the set.
+    //  Runtime counterpart of parser_keywords: the same trie, with its nodes in a std::vector.
+    //  If no keyword matches, it attempts an error recovery strategy and returns std::nullopt.
+    template<typename token_type>
+    class parser_multi_keywords : public base_parser<token_type, parser_multi_keywords<token_type>> {
+    public:
+
+        template<typename sequence_type>
+        explicit parser_multi_keywords(const std::vector<sequence_type> & words) {
+            size_t capacity = 1;
+            for (const auto & word : words)
+                capacity += std::ranges::size(word);
+            nodes.resize(capacity);
+            size_t count = 1;
+            for (size_t i = 0; i < words.size(); i++) {
+                count = keyword_insert(nodes, count, std::ranges::data(words[i]), std::ranges::size(words[i]), static_cast<int32_t>(i));
+                max_length = std::max(max_length, static_cast<size_t>(std::ranges::size(words[i])));
+            }
+            nodes.resize(count);
+            std::copy_n("Keywords", 8, this->parser_name);
+        }
+
+        template<typename Stream, typename GlobalState, typename State>
+        auto parse_impl(Stream& stream, GlobalState&, State&) const {
+            auto [keyword, length] = keyword_match(nodes, stream, max_length);
+            if (keyword < 0) {
+                this->error_handle_recovery(stream);
+                return std::optional<size_t>();
+            }
+            stream.Seek(length);
+            return std::make_optional(static_cast<size_t>(keyword));
+        }
+
+        template<typename Stream>
+        bool peek_impl(Stream & stream) const {
+            return keyword_match(nodes, stream, max_length).first >= 0;
+        }
+
+    private:
+        std::vector<keyword_node<token_type>> nodes;
+        size_t max_length = 0;
+    };
+
+
+    // A regular expression over bytes, compiled to a Thompson NFA at construction and determinized lazily:
+    //  each DFA state (a set of NFA states) and each of its 256 transitions is built the first time a match reaches it,
+    //  then reused, so matching costs one table lookup per byte once the reachable part of the DFA is built.
+    //  At most `max_states` states are kept: when a match needs one more, the cache is flushed and rebuilt
+    //  from the states the following input reaches, so patterns with exponentially many DFA states stay bounded.
+    //  Supported syntax: literals, `.`, `[...]` classes with ranges and `^`, escapes (`\d \w \s \D \W \S \n \t \r \xHH`),
+    //  groups `(...)` and `(?:...)` (nothing is captured), `|`, and the quantifiers `* + ? {m} {m,} {m,n}`.
+    //  Anchors, lazy quantifiers and backreferences are not supported. Invalid patterns throw std::runtime_error.
+    class regex_dfa {
+    public:
+        static constexpr int32_t dead = -1;
+
+        // Each state holds a 1 KiB transition row, so the cache is bounded to about 4 MiB.
+        static constexpr size_t max_states = 4096;
+
+        explicit regex_dfa(std::string_view _pattern) : pattern(_pattern) {
+            auto body = parse_alternation();
+            if (position != pattern.size())
+                fail("unbalanced ')'");
+            accept = add_state(-1, -1, -1);
+            states[body.end].out = accept;
+            nfa_start = body.start;
+            start_state = add_dfa_state(closure({nfa_start}));
+        }
+
+        [[nodiscard]] int32_t start() const {
+            return start_state;
+        }
+
+        [[nodiscard]] bool accepting(int32_t state) const {
+            return accepts[state];
+        }
+
+        // Number of DFA states currently built.
+        [[nodiscard]] size_t cached_states() const {
+            return sets.size();
+        }
+
+        // The DFA state reached from `state` on byte `c`, or `dead`.
+        //  Flushing the cache invalidates every other state id, so callers only keep the returned one.
+        int32_t next(int32_t state, unsigned char c) {
+            if (transitions[state][c] == unknown) {
+                std::vector<int32_t> seeds;
+                for (auto nfa_state: sets[state]) {
+                    if (states[nfa_state].byte_class >= 0 && classes[states[nfa_state].byte_class][c])
+                        seeds.push_back(states[nfa_state].out);
+                }
+                if (seeds.empty()) {
+                    transitions[state][c] = dead;
+                    return dead;
+                }
+                auto set = closure(seeds);
+                if (sets.size() >= max_states && !dfa_ids.contains(set)) {
+                    flush();
+                    return add_dfa_state(std::move(set));
+                }
+                transitions[state][c] = add_dfa_state(std::move(set));
+            }
+            return transitions[state][c];
+        }
+
+    private:
+        static constexpr int32_t unknown = -2;
+
+        // An NFA state either consumes a byte of `classes[byte_class]` and moves to `out`,
+        //  or (byte_class == -1) moves to `out` and `out1` without consuming input.
+        struct nfa_state {
+            int32_t out;
+            int32_t out1;
+            int32_t byte_class;
+        };
+
+        // A partial NFA entered at `start`; `end` is an epsilon state whose `out` is linked by the caller.
+        struct fragment {
+            int32_t start;
+            int32_t end;
+        };
+
+        std::string pattern;
+        size_t position = 0;
+
+        std::vector<nfa_state> states;
+        std::vector<std::bitset<256>> classes;
+        int32_t accept = -1;
+        int32_t nfa_start = -1;
+
+        std::map<std::vector<int32_t>, int32_t> dfa_ids;
+        std::vector<std::vector<int32_t>> sets;
+        std::vector<std::array<int32_t, 256>> transitions;
+        std::vector<bool> accepts;
+        int32_t start_state = dead;
+
+        [[noreturn]] void fail(const char *reason) const {
+            throw std::runtime_error("Invalid regex pattern: " + pattern + " (" + reason + ")");
+        }
+
+        int32_t add_state(int32_t out, int32_t out1, int32_t byte_class) {
+            states.push_back({out, out1, byte_class});
+            return static_cast<int32_t>(states.size() - 1);
+        }
+
+        fragment empty() {
+            auto state = add_state(-1, -1, -1);
+            return {state, state};
+        }
+
+        fragment single(const std::bitset<256> &byte_class) {
+            classes.push_back(byte_class);
+            auto end = add_state(-1, -1, -1);
+            return {add_state(end, -1, static_cast<int32_t>(classes.size() - 1)), end};
+        }
+
+        fragment concat(fragment left, fragment right) {
+            states[left.end].out = right.start;
+            return {left.start, right.end};
+        }
+
+        fragment either(fragment left, fragment right) {
+            auto end = add_state(-1, -1, -1);
+            states[left.end].out = end;
+            states[right.end].out = end;
+            return {add_state(left.start, right.start, -1), end};
+        }
+
+        fragment star(fragment body) {
+            auto end = add_state(-1, -1, -1);
+            auto loop = add_state(body.start, end, -1);
+            states[body.end].out = loop;
+            return {loop, end};
+        }
+
+        fragment plus(fragment body) {
+            auto end = add_state(-1, -1, -1);
+            states[body.end].out = add_state(body.start, end, -1);
+            return {body.start, end};
+        }
+
+        fragment optional(fragment body) {
+            auto end = add_state(-1, -1, -1);
+            states[body.end].out = end;
+            return {add_state(body.start, end, -1), end};
+        }
+
+        fragment parse_alternation() {
+            auto result = parse_concat();
+            while (position < pattern.size() && pattern[position] == '|') {
+                position++;
+                result = either(result, parse_concat());
+            }
+            return result;
+        }
+
+        fragment parse_concat() {
+            auto result = empty();
+            while (position < pattern.size() && pattern[position] != '|' && pattern[position] != ')')
+                result = concat(result, parse_repeat());
+            return result;
+        }
+
+        fragment parse_repeat() {
+            size_t atom_begin = position;
+            auto result = parse_atom();
+            bool quantified = false;
+            while (position < pattern.size()) {
+                char c = pattern[position];
+                if (c == '*' || c == '+' || c == '?') {
+                    position++;
+                    result = c == '*' ? star(result) : c == '+' ? plus(result) : optional(result);
+                }
+                else if (c == '{') {
+                    if (quantified)
+                        fail("counted repetition of a quantified expression");
+                    result = parse_counted(atom_begin, result);
+                }
+                else
+                    break;
+                quantified = true;
+            }
+            return result;
+        }
+
+        // `atom{m}`, `atom{m,}` and `atom{m,n}`: the atom is parsed again for every extra copy.
+        fragment parse_counted(size_t atom_begin, fragment atom) {
+            position++;
+            size_t min = parse_number(), max = min;
+            bool unbounded = false;
+            if (position < pattern.size() && pattern[position] == ',') {
+                position++;
+                if (position < pattern.size() && pattern[position] == '}')
+                    unbounded = true;
+                else
+                    max = parse_number();
+            }
+            if (position >= pattern.size() || pattern[position] != '}' || max < min)
+                fail("malformed {m,n}");
+            position++;
+            size_t after = position;
+
+            bool atom_used = false;
+            auto copy = [&]() {
+                if (!atom_used) {
+                    atom_used = true;
+                    return atom;
+                }
+                position = atom_begin;
+                auto again = parse_atom();
+                position = after;
+                return again;
+            };
+            auto result = empty();
+            for (size_t i = 0; i < min; i++)
+                result = concat(result, copy());
+            if (unbounded)
+                result = concat(result, star(copy()));
+            for (size_t i = min; i < max; i++)
+                result = concat(result, optional(copy()));
+            return result;
+        }
+
+        size_t parse_number() {
+            size_t value = 0, begin = position;
+            while (position < pattern.size() && pattern[position] >= '0' && pattern[position] <= '9')
+                value = value * 10 + (pattern[position++] - '0');
+            if (position == begin || value > 1000)
+                fail("malformed {m,n}");
+            return value;
+        }
+
+        fragment parse_atom() {
+            char c = pattern[position++];
+            switch (c) {
+                case '(': {
+                    if (pattern.compare(position, 2, "?:") == 0)
+                        position += 2;
+                    auto group = parse_alternation();
+                    if (position >= pattern.size() || pattern[position] != ')')
+                        fail("missing ')'");
+                    position++;
+                    return group;
+                }
+                case '[':
+                    return single(parse_class());
+                case '.': {
+                    std::bitset<256> any;
+                    any.set();
+                    any.reset('\n');
+                    return single(any);
+                }
+                case '\\':
+                    return single(parse_escape());
+                case '*':
+                case '+':
+                case '?':
+                case '{':
+                    fail("quantifier without operand");
+                default: {
+                    std::bitset<256> literal;
+                    literal.set(static_cast<unsigned char>(c));
+                    return single(literal);
+                }
+            }
+        }
+
+        std::bitset<256> parse_class() {
+            std::bitset<256> result;
+            bool negate = position < pattern.size() && pattern[position] == '^';
+            if (negate)
+                position++;
+            bool first = true;
+            while (position < pattern.size() && (pattern[position] != ']' || first)) {
+                first = false;
+                if (pattern[position] == '\\') {
+                    position++;
+                    auto escaped = parse_escape();
+                    if (escaped.count() == 1)
+                        add_class_item(result, single_byte(escaped));
+                    else
+                        result |= escaped;
+                    continue;
+                }
+                add_class_item(result, static_cast<unsigned char>(pattern[position++]));
+            }
+            if (position >= pattern.size())
+                fail("missing ']'");
+            position++;
+            if (negate)
+                result.flip();
+            return result;
+        }
+
+        // Adds `first`, or the range `first-last` when a range follows, to a class being parsed.
+        void add_class_item(std::bitset<256> &result, unsigned char first) {
+            if (position + 1 < pattern.size() && pattern[position] == '-' && pattern[position + 1] != ']') {
+                position++;
+                unsigned char last;
+                if (pattern[position] == '\\') {
+                    position++;
+                    auto escaped = parse_escape();
+                    if (escaped.count() != 1)
+                        fail("class escape as range bound");
+                    last = single_byte(escaped);
+                }
+                else
+                    last = static_cast<unsigned char>(pattern[position++]);
+                if (last < first)
+                    fail("reversed range");
+                for (unsigned b = first; b <= last; b++)
+                    result.set(b);
+            }
+            else
+                result.set(first);
+        }
+
+        static unsigned char single_byte(const std::bitset<256> &byte_class) {
+            unsigned b = 0;
+            while (!byte_class[b])
+                b++;
+            return static_cast<unsigned char>(b);
+        }
+
+        std::bitset<256> parse_escape() {
+            if (position >= pattern.size())
+                fail("trailing '\\'");
+            char c = pattern[position++];
+            std::bitset<256> result;
+            auto add_range = [&result](unsigned char first, unsigned char last) {
+                for (unsigned b = first; b <= last; b++)
+                    result.set(b);
+            };
+            switch (c) {
+                case 'd': case 'D':
+                    add_range('0', '9');
+                    break;
+                case 'w': case 'W':
+                    add_range('0', '9');
+                    add_range('a', 'z');
+                    add_range('A', 'Z');
+                    result.set('_');
+                    break;
+                case 's': case 'S':
+                    for (char space: {' ', '\t', '\n', '\r', '\f', '\v'})
+                        result.set(static_cast<unsigned char>(space));
+                    break;
+                case 'n': result.set('\n'); break;
+                case 't': result.set('\t'); break;
+                case 'r': result.set('\r'); break;
+                case 'f': result.set('\f'); break;
+                case 'v': result.set('\v'); break;
+                case 'x': {
+                    unsigned value = 0;
+                    for (int i = 0; i < 2; i++) {
+                        if (position >= pattern.size() || !std::isxdigit(static_cast<unsigned char>(pattern[position])))
+                            fail("malformed \\x escape");
+                        char digit = pattern[position++];
+                        value = value * 16 + (std::isdigit(static_cast<unsigned char>(digit)) ? digit - '0' : (digit | 0x20) - 'a' + 10);
+                    }
+                    result.set(value);
+                    break;
+                }
+                default:
+                    result.set(static_cast<unsigned char>(c));
+            }
+            if (c == 'D' || c == 'W' || c == 'S')
+                result.flip();
+            return result;
+        }
+
+        // The states reachable from `seeds` without consuming input, keeping those that consume a byte or accept.
+        std::vector<int32_t> closure(std::vector<int32_t> seeds) const {
+            std::vector<bool> visited(states.size());
+            std::vector<int32_t> result;
+            while (!seeds.empty()) {
+                auto state = seeds.back();
+                seeds.pop_back();
+                if (state < 0 || visited[state])
+                    continue;
+                visited[state] = true;
+                const auto &node = states[state];
+                if (node.byte_class >= 0 || state == accept)
+                    result.push_back(state);
+                else {
+                    seeds.push_back(node.out);
+                    seeds.push_back(node.out1);
+                }
+            }
+            std::sort(result.begin(), result.end());
+            return result;
+        }
+
+        // Drops every built state except the start state.
+        void flush() {
+            dfa_ids.clear();
+            sets.clear();
+            transitions.clear();
+            accepts.clear();
+            start_state = add_dfa_state(closure({nfa_start}));
+        }
+
+        int32_t add_dfa_state(std::vector<int32_t> &&set) {
+            if (set.empty())
+                return dead;
+            auto [it, inserted] = dfa_ids.try_emplace(set, static_cast<int32_t>(sets.size()));
+            if (inserted) {
+                accepts.push_back(std::binary_search(set.begin(), set.end(), accept));
+                sets.push_back(std::move(set));
+                transitions.emplace_back();
+                transitions.back().fill(unknown);
+            }
+            return it->second;
+        }
+    };
+
+    // A parser that matches a regular expression at the cursor (leftmost-longest), returning the matched tokens:
+    //  a std::basic_string_view into streams with stable windows (with the same lifetime as `Capture`), a copy otherwise.
+    //  The pattern is compiled once at construction; the lazily built DFA is shared by the copies of the parser,
+    //  so a parser must not be used from several threads at once.
+    //  Tokens must be single bytes. If the expression does not match, it attempts an error recovery strategy and returns std::nullopt.
+    template<typename token_type>
+    requires (sizeof(token_type) == 1)
+    class parser_regex : public base_parser<token_type, parser_regex<token_type>> {
+    public:
+
+        explicit parser_regex(std::string_view pattern) : dfa(std::make_shared<regex_dfa>(pattern)) {
+            std::copy_n(pattern.data(), std::min(pattern.size(), sizeof(this->parser_name) - 1), this->parser_name);
+        }
+
+        template<typename Stream, typename GlobalState, typename State>
+        auto parse_impl(Stream& stream, GlobalState&, State&) const {
+            using result_type = std::conditional_t<has_stable_window_v<Stream>,
+                    result_view_t<token_type>, result_container_t<token_type>>;
+            auto length = match(stream);
+            if (length < 0) {
+                this->error_handle_recovery(stream);
+                return std::optional<result_type>();
+            }
+            if constexpr (is_contiguous_stream_v<Stream>) {
+                // The block of an unstable window is copied before `Seek()` may refill or remap it.
+                auto block = stream.Window(length);
+                auto result = std::make_optional(result_type(block.begin(), block.end()));
+                stream.Seek(length);
+                return result;
+            }
+            else {
+                result_type result;
+                result.reserve(length);
+                for (ptrdiff_t i = 0; i < length; i++)
+                    result.push_back(stream.Get());
+                return std::make_optional(std::move(result));
+            }
+        }
+
+        template<typename Stream, typename GlobalState, typename State>
+        bool recognize_impl(Stream& stream, GlobalState&, State&) const {
+            auto length = match(stream);
+            if (length < 0) {
+                this->error_handle_recovery(stream);
+                return false;
+            }
+            stream.Seek(length);
+            return true;
+        }
+
+        template<typename Stream>
+        bool peek_impl(Stream & stream) const {
+            return match(stream) >= 0;
+        }
+
+    private:
+        // Length of the longest match at the cursor, or -1. Runs the DFA until it dies or the input ends,
+        //  over `Window()` blocks on contiguous streams and `Peek()` elsewhere.
+        template<typename Stream>
+        ptrdiff_t match(Stream & stream) const {
+            int32_t state = dfa->start();
+            ptrdiff_t longest = dfa->accepting(state) ? 0 : -1;
+            size_t i = 0;
+            auto step = [&](token_type token) {
+                state = dfa->next(state, static_cast<unsigned char>(token));
+                if (state == regex_dfa::dead)
+                    return false;
+                if (dfa->accepting(state))
+                    longest = static_cast<ptrdiff_t>(i + 1);
+                return true;
+            };
+            if constexpr (is_contiguous_stream_v<Stream>) {
+                size_t request = 64;
+                while (true) {
+                    // push_stream: look at the received tokens, then let Eof() ask for more input.
+                    if constexpr (requires { stream.Available(); })
+                        request = stream.Available();
+                    auto window = stream.Window(request);
+                    for (; i < window.size(); i++) {
+                        if (!step(window[i]))
+                            return longest;
+                    }
+                    if constexpr (requires { stream.Available(); }) {
+                        if (stream.Eof(i))
+                            return longest;
+                    }
+                    else {
+                        if (window.size() < request)
+                            return longest;
+                        request *= 2;
+                    }
+                }
+            }
+            else {
+                for (; !stream.Eof(i); i++) {
+                    if (!step(stream.Peek(i)))
+                        break;
+                }
+                return longest;
+            }
+        }
+
+        std::shared_ptr<regex_dfa> dfa;
+    };
 
     // A parser that matches tokens.
     //  If the match is successful, it returns a 'result_type' constructed with the sequence as an argument;
@@ -134,13 +654,18 @@ namespace pkuyo::parsers {
 
         template<typename Stream>
         bool peek_impl(Stream & stream) const {
-            int index = 0;
-            for(const auto & it : expected_seq) {
-                if(stream.Eof(index) || stream.Peek(index) != it)
-                    return false;
-                index++;
+            if constexpr (std::ranges::contiguous_range<sequence_type>) {
+                return match_sequence(stream, std::ranges::data(expected_seq), std::ranges::size(expected_seq));
+            }
+            else {
+                int index = 0;
+                for(const auto & it : expected_seq) {
+                    if(stream.Eof(index) || stream.Peek(index) != it)
+                        return false;
+                    index++;
+                }
+                return true;
             }
-            return true;
         }
 
     private:
@@ -172,18 +697,16 @@ namespace pkuyo::parsers {
 //    auto SeqCheck(const wchar_t *str) {
 //        return SeqCheck<wchar_t>(std::wstring_view(str));
 //    }
-//
-//
-//    template<typename token_type,size_t pred_count = 1>
-//    auto Regex(const std::string & pattern) {
-//        return parser_regex<token_type,pred_count>(pattern);
-//    }
-//
-//
-//    template<typename token_type = char,size_t pred_count = 1>
-//    auto Regex(const char* pattern) {
-//        return parser_regex<token_type,pred_count>(std::string(pattern));
-//    }
+
+    template<typename token_type = char>
+    auto Regex(std::string_view pattern) {
+        return parser_regex<token_type>(pattern);
+    }
+
+    template<typename token_type, typename sequence_type>
+    auto Keywords(const std::vector<sequence_type> & words) {
+        return parser_multi_keywords<token_type>(words);
+    }
 
     template<typename token_type, typename cmp_type, typename return_type>
     auto SeqValue(const cmp_type & cmp_value) {
@@ -0,0 +1,191 @@
+// simd.h
+/**
+ * @file simd.h
+ * @brief Vectorized scanning primitives shared by token streams and parsers.
+ * @author pkuyo
+ * @date 2025-02-08
+ * @copyright Copyright (c) 2025 pkuyo. All rights reserved.
+ *
+ * Includes:
+ * - Instruction set detection (LIGHT_PARSER_SSE2 / LIGHT_PARSER_SSSE3 / LIGHT_PARSER_AVX2)
+ * - Bulk byte search collecting every match offset (scan_bytes)
+ * - First match byte search (find_byte)
+ * - Leading ASCII run detection (ascii_prefix)
+ * - Leading run of a byte class through a nibble table lookup (class_prefix)
+ */
+
+#ifndef LIGHT_PARSER_SIMD_H
+#define LIGHT_PARSER_SIMD_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#define LIGHT_PARSER_AVX2
+#endif
+
+#if defined(__SSSE3__) || defined(LIGHT_PARSER_AVX2)
+#define LIGHT_PARSER_SSSE3
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define LIGHT_PARSER_SSE2
+#endif
+
+#if defined(LIGHT_PARSER_AVX2)
+#include <immintrin.h>
+#elif defined(LIGHT_PARSER_SSSE3)
+#include <tmmintrin.h>
+#elif defined(LIGHT_PARSER_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace pkuyo::parsers::simd {
+
+    // Calls `on_match(index)` for every index in `[0, size)` where `data[index] == target`, in order.
+    // Compares 32 (AVX2) or 16 (SSE2) bytes per step and falls back to memchr elsewhere.
+    template<typename FF>
+    void scan_bytes(const char *data, size_t size, char target, FF &&on_match) {
+        size_t i = 0;
+#if defined(LIGHT_PARSER_AVX2)
+        const __m256i wide_target = _mm256_set1_epi8(target);
+        for (; i + 32 <= size; i += 32) {
+            auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            auto mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, wide_target)));
+            for (; mask; mask &= mask - 1)
+                on_match(i + std::countr_zero(mask));
+        }
+#endif
+#if defined(LIGHT_PARSER_SSE2)
+        const __m128i narrow_target = _mm_set1_epi8(target);
+        for (; i + 16 <= size; i += 16) {
+            auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, narrow_target)));
+            for (; mask; mask &= mask - 1)
+                on_match(i + std::countr_zero(mask));
+        }
+#endif
+        while (i < size) {
+            auto found = static_cast<const char *>(std::memchr(data + i, target, size - i));
+            if (!found)
+                break;
+            i = found - data;
+            on_match(i++);
+        }
+    }
+
+    // Returns the index of the first byte in `[0, size)` equal to `target`, or `size` if there is none.
+    //  Compares 32 (AVX2) or 16 (SSE2) bytes per step and falls back to memchr elsewhere.
+    inline size_t find_byte(const char *data, size_t size, char target) {
+        size_t i = 0;
+#if defined(LIGHT_PARSER_AVX2)
+        const __m256i wide_target = _mm256_set1_epi8(target);
+        for (; i + 32 <= size; i += 32) {
+            auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            auto mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, wide_target)));
+            if (mask)
+                return i + std::countr_zero(mask);
+        }
+#endif
+#if defined(LIGHT_PARSER_SSE2)
+        const __m128i narrow_target = _mm_set1_epi8(target);
+        for (; i + 16 <= size; i += 16) {
+            auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, narrow_target)));
+            if (mask)
+                return i + std::countr_zero(mask);
+        }
+#endif
+        if (i == size)
+            return size;
+        auto found = static_cast<const char *>(std::memchr(data + i, target, size - i));
+        return found ? found - data : size;
+    }
+
+    // Returns the length of the leading run of ASCII bytes (high bit clear) in `[0, size)`.
+    // Tests 32 (AVX2) or 16 (SSE2) bytes per step through the sign-bit mask.
+    inline size_t ascii_prefix(const char *data, size_t size) {
+        size_t i = 0;
+#if defined(LIGHT_PARSER_AVX2)
+        for (; i + 32 <= size; i += 32) {
+            auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            auto mask = static_cast<unsigned>(_mm256_movemask_epi8(block));
+            if (mask)
+                return i + std::countr_zero(mask);
+        }
+#endif
+#if defined(LIGHT_PARSER_SSE2)
+        for (; i + 16 <= size; i += 16) {
+            auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            auto mask = static_cast<unsigned>(_mm_movemask_epi8(block));
+            if (mask)
+                return i + std::countr_zero(mask);
+        }
+#endif
+        while (i < size && static_cast<unsigned char>(data[i]) < 0x80)
+            i++;
+        return i;
+    }
+
+    // Checks whether byte `c` belongs to the class described by `table`.
+    //  Layout (shared with the vector lookups): byte `c` is bit `(c >> 4) & 7` of `table[(c & 15) + 16 * (c >> 7)]`.
+    constexpr bool class_contains(const uint8_t (&table)[32], unsigned char c) {
+        return (table[(c & 15) + ((c >> 7) << 4)] >> ((c >> 4) & 7)) & 1;
+    }
+
+    // Returns the length of the leading run of bytes in `[0, size)` that belong to the class `table` (see class_contains).
+    //  Classifies 32 (AVX2) or 16 (SSSE3) bytes per step with two shuffle lookups, and one byte at a time elsewhere.
+    inline size_t class_prefix(const char *data, size_t size, const uint8_t (&table)[32]) {
+        size_t i = 0;
+#if defined(LIGHT_PARSER_AVX2)
+        {
+            const __m256i low_rows = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(table)));
+            const __m256i high_rows = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(table + 16)));
+            const __m256i bit_of = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                                    1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+            const __m256i nibble = _mm256_set1_epi8(0x0F);
+            for (; i + 32 <= size; i += 32) {
+                auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                auto low = _mm256_and_si256(block, nibble);
+                auto high = _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble);
+                auto upper_half = _mm256_cmpgt_epi8(_mm256_setzero_si256(), block);
+                auto rows = _mm256_blendv_epi8(_mm256_shuffle_epi8(low_rows, low), _mm256_shuffle_epi8(high_rows, low), upper_half);
+                auto bits = _mm256_shuffle_epi8(bit_of, high);
+                auto member = _mm256_cmpeq_epi8(_mm256_and_si256(rows, bits), bits);
+                auto mask = ~static_cast<unsigned>(_mm256_movemask_epi8(member));
+                if (mask)
+                    return i + std::countr_zero(mask);
+            }
+        }
+#endif
+#if defined(LIGHT_PARSER_SSSE3)
+        {
+            const __m128i low_rows = _mm_loadu_si128(reinterpret_cast<const __m128i *>(table));
+            const __m128i high_rows = _mm_loadu_si128(reinterpret_cast<const __m128i *>(table + 16));
+            const __m128i bit_of = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+            const __m128i nibble = _mm_set1_epi8(0x0F);
+            for (; i + 16 <= size; i += 16) {
+                auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                auto low = _mm_and_si128(block, nibble);
+                auto high = _mm_and_si128(_mm_srli_epi16(block, 4), nibble);
+                auto upper_half = _mm_cmplt_epi8(block, _mm_setzero_si128());
+                auto rows = _mm_or_si128(_mm_andnot_si128(upper_half, _mm_shuffle_epi8(low_rows, low)),
+                                         _mm_and_si128(upper_half, _mm_shuffle_epi8(high_rows, low)));
+                auto bits = _mm_shuffle_epi8(bit_of, high);
+                auto member = _mm_cmpeq_epi8(_mm_and_si128(rows, bits), bits);
+                auto mask = ~static_cast<unsigned>(_mm_movemask_epi8(member)) & 0xFFFFu;
+                if (mask)
+                    return i + std::countr_zero(mask);
+            }
+        }
+#endif
+        while (i < size && class_contains(table, static_cast<unsigned char>(data[i])))
+            i++;
+        return i;
+    }
+
+}
+
+#endif //LIGHT_PARSER_SIMD_H
@@ -6,22 +6,49 @@
  * @copyright Copyright (c) 2025 pkuyo. All rights reserved.
  *
  * Includes:
+ * - Structured source position (source_position) and lazily rendered diagnostics (lazy_text)
  * - Base token stream template class base_token_stream
  * - String-based stream implementations (basic_string_stream)
+ * - Non-owning string stream over borrowed buffers (basic_string_view_stream)
  * - Generic container input stream (container_stream)
- * - File input stream with buffering and position tracking (file_stream)
+ * - Non-owning token stream over contiguous ranges (span_stream)
+ * - Incrementally fed stream for push-based parsing (push_stream)
+ * - Lazily built newline index for line / column resolution (line_index)
+ * - File input stream with ring buffering and position tracking (file_stream)
+ * - File stream with background read-ahead on an I/O thread (prefetch_file_stream)
+ * - Windowed and tailing memory-mapped file stream (windowed_mmap_file_stream, POSIX only)
+ * - Contiguous stream capability trait (is_contiguous_stream)
+ * - Stable window trait (has_stable_window)
+ * - UTF-8 decoding adapter producing code points (utf8_stream)
+ * - On-demand lexing adapter over a character stream (lexer_stream)
+ * - Call-counting wrapper for profiling grammars (instrumented_stream)
+ * - Compile-time error policy trait (stream_error_policy) and exception-free wrapper (status_stream)
  */
 
 #ifndef LIGHT_PARSER_TOKEN_STREAM_H
 #define LIGHT_PARSER_TOKEN_STREAM_H
 
 #include <cstdlib>
+#include <cstdint>
+#include <atomic>
 #include <iterator>
 #include <string>
+#include <string_view>
+#include <span>
+#include <ranges>
 #include <vector>
 #include <fstream>
-#include <deque>
 #include <memory>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <utility>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "simd.h"
 
 
 #ifdef IS_WINDOWS
@@ -39,6 +66,16 @@
 
 namespace pkuyo::parsers {
 
+    // Position of a token inside a stream: the token offset plus the id of the owning stream.
+    //  Trivially copyable and allocation-free; render it with `Pos(position)` only when a diagnostic is printed.
+    struct source_position {
+        size_t offset = 0;
+        uint32_t stream_id = 0;
+
+        friend bool operator==(const source_position &, const source_position &) = default;
+    };
+
+
     template<typename token_type, typename derived_type>
     class base_token_stream {
     public:
@@ -61,14 +98,36 @@ namespace pkuyo::parsers {
             return derived().eof_impl(lookahead);
         }
 
+        // Gets the structured position of the next token.
+        source_position Position() {
+            return {derived().offset_impl(), stream_id};
+        }
+
+        // Renders a position previously returned by `Position()`.
+        std::string Pos(const source_position &position) {
+            return derived().pos_impl(position.offset);
+        }
+
         std::string Pos() {
-            return derived().pos_impl();
+            return Pos(Position());
+        }
+
+        // Number of tokens before the cursor. Equal to `Position().offset` except for adapters
+        //  whose positions are offsets into an underlying stream (utf8_stream, lexer_stream).
+        size_t Index() {
+            return derived().index_impl();
         }
 
         auto Save() {
             return derived().save_impl();
         }
 
+        // Returns up to `length` upcoming tokens as one contiguous block, without consuming them.
+        // Only available on streams for which `is_contiguous_stream_v` holds.
+        std::span<const token_type> Window(size_t length) {
+            return derived().window_impl(length);
+        }
+
         void Restore(auto&& state) {
             return derived().restore_impl(state);
         }
@@ -77,8 +136,14 @@ namespace pkuyo::parsers {
         std::string Value() {
             if(Eof())
                 return "EOF";
-            return derived().value_impl();
+            return derived().value_impl(derived().offset_impl());
+
+        }
 
+        // Renders the token at a position previously returned by `Position()`.
+        //  Buffered streams render an empty string once that token has been released.
+        std::string Value(const source_position &position) {
+            return derived().value_impl(position.offset);
         }
 
 
@@ -88,8 +153,12 @@ namespace pkuyo::parsers {
 
 
     protected:
-        std::string value_impl() {
-            return Peek(0);
+        std::string value_impl(size_t offset) {
+            return offset == derived().offset_impl() ? std::string(1, Peek(0)) : std::string();
+        }
+
+        size_t index_impl() {
+            return derived().offset_impl();
         }
 
 
@@ -97,10 +166,64 @@ namespace pkuyo::parsers {
 
         std::string name;
 
+        uint32_t stream_id = next_stream_id();
+
         derived_type &derived() { return static_cast<derived_type &>(*this); }
 
         const derived_type &derived() const { return static_cast<const derived_type &>(*this); }
 
+    private:
+        static uint32_t next_stream_id() {
+            static std::atomic<uint32_t> counter{0};
+            return ++counter;
+        }
+
+    };
+
+
+    // Diagnostic text taken from a stream (the current token value or a position), rendered on demand.
+    //  Only holds a pointer to the stream and the position it was taken at, so nothing is formatted unless
+    //  `str()` is called, and it still renders that token after the stream has moved on.
+    //  A lazy_text must not outlive its stream.
+    class lazy_text {
+    public:
+        template<typename Stream>
+        static lazy_text value_of(Stream &stream) {
+            if (stream.Eof())
+                return {&stream, stream.Position(), [](void *, const source_position &) {
+                    return std::string("EOF");
+                }};
+            return {&stream, stream.Position(), [](void *s, const source_position &position) {
+                return static_cast<Stream *>(s)->Value(position);
+            }};
+        }
+
+        template<typename Stream>
+        static lazy_text position_of(Stream &stream) {
+            return {&stream, stream.Position(), [](void *s, const source_position &position) {
+                return static_cast<Stream *>(s)->Pos(position);
+            }};
+        }
+
+        [[nodiscard]] std::string str() const {
+            return render(stream, position);
+        }
+
+        operator std::string() const {
+            return str();
+        }
+
+        [[nodiscard]] const source_position &Position() const {
+            return position;
+        }
+
+    private:
+        lazy_text(void *_stream, const source_position &_position, std::string (*_render)(void *, const source_position &))
+                : stream(_stream), position(_position), render(_render) {}
+
+        void *stream;
+        source_position position;
+        std::string (*render)(void *, const source_position &);
     };
 
 
@@ -124,16 +247,20 @@ namespace pkuyo::parsers {
             return position + lookahead >= source.size();
         }
 
-        std::string pos_impl() {
-            return std::format("index: {}",position);
+        size_t offset_impl() const {
+            return position;
+        }
+
+        std::string pos_impl(size_t offset) const {
+            return std::format("index: {}",offset);
         }
 
         void seek_impl(size_t length) {
             position += length;
         }
 
-        std::string value_impl() const {
-            return std::string(1,source[position]);
+        std::string value_impl(size_t offset) const {
+            return std::string(1,source[offset]);
         }
 
         auto save_impl() {
@@ -144,12 +271,22 @@ namespace pkuyo::parsers {
             position = state;
         }
 
+        std::span<const char_type> window_impl(size_t length) const {
+            size_t start = std::min(position, source.size());
+            return {source.data() + start, std::min(length, source.size() - start)};
+        }
+
     public:
         explicit basic_string_stream(const std::basic_string<char_type> &str) : source(str) {}
         explicit basic_string_stream(const std::basic_string<char_type> &str,std::string_view _name) : source(str) {
             this->name = _name;
         }
 
+        explicit basic_string_stream(std::basic_string<char_type> &&str) : source(std::move(str)) {}
+        explicit basic_string_stream(std::basic_string<char_type> &&str,std::string_view _name) : source(std::move(str)) {
+            this->name = _name;
+        }
+
         basic_string_stream(const basic_string_stream&) = delete;
         basic_string_stream& operator=(const basic_string_stream&) = delete;
 
@@ -159,6 +296,108 @@ namespace pkuyo::parsers {
     using wstring_stream = basic_string_stream<wchar_t>;
 
 
+    // Non-owning counterpart of basic_string_stream.
+    //  Reads directly from a borrowed buffer (string_view, span or pointer + length) without copying it,
+    //  so the underlying data must outlive the stream.
+    template<typename char_type>
+    class basic_string_view_stream : public base_token_stream<char_type,basic_string_view_stream<char_type>> {
+        friend class base_token_stream<char_type,basic_string_view_stream<char_type>>;
+
+        std::basic_string_view<char_type> source;
+        size_t position = 0;
+
+        char_type get_impl() {
+            return source[position++];
+        }
+
+        char_type peek_impl(size_t lookahead) {
+            return source[position + lookahead] ;
+        }
+
+        bool eof_impl(size_t lookahead) const {
+            return position + lookahead >= source.size();
+        }
+
+        size_t offset_impl() const {
+            return position;
+        }
+
+        std::string pos_impl(size_t offset) const {
+            return std::format("index: {}",offset);
+        }
+
+        void seek_impl(size_t length) {
+            position += length;
+        }
+
+        std::string value_impl(size_t offset) const {
+            return std::string(1,source[offset]);
+        }
+
+        auto save_impl() {
+            return position;
+        }
+
+        auto restore_impl(auto&& state) {
+            position = state;
+        }
+
+        std::span<const char_type> window_impl(size_t length) const {
+            size_t start = std::min(position, source.size());
+            return {source.data() + start, std::min(length, source.size() - start)};
+        }
+
+    public:
+        explicit basic_string_view_stream(std::basic_string_view<char_type> str) : source(str) {}
+        explicit basic_string_view_stream(std::basic_string_view<char_type> str,std::string_view _name) : source(str) {
+            this->name = _name;
+        }
+
+        explicit basic_string_view_stream(std::span<const char_type> buffer)
+                : source(buffer.data(),buffer.size()) {}
+        explicit basic_string_view_stream(std::span<const char_type> buffer,std::string_view _name)
+                : source(buffer.data(),buffer.size()) {
+            this->name = _name;
+        }
+
+        explicit basic_string_view_stream(const std::basic_string<char_type> &str) : source(str) {}
+        explicit basic_string_view_stream(const std::basic_string<char_type> &str,std::string_view _name) : source(str) {
+            this->name = _name;
+        }
+
+        explicit basic_string_view_stream(const char_type *str) : source(str) {}
+        explicit basic_string_view_stream(const char_type *str,std::string_view _name) : source(str) {
+            this->name = _name;
+        }
+
+        basic_string_view_stream(const char_type *data, size_t size) : source(data,size) {}
+        basic_string_view_stream(const char_type *data, size_t size,std::string_view _name) : source(data,size) {
+            this->name = _name;
+        }
+
+        // Borrowing a temporary string would leave the stream dangling.
+        explicit basic_string_view_stream(std::basic_string<char_type> &&) = delete;
+        explicit basic_string_view_stream(std::basic_string<char_type> &&,std::string_view) = delete;
+
+        basic_string_view_stream(const basic_string_view_stream&) = delete;
+        basic_string_view_stream& operator=(const basic_string_view_stream&) = delete;
+
+    };
+
+    using string_view_stream = basic_string_view_stream<char>;
+    using wstring_view_stream = basic_string_view_stream<wchar_t>;
+
+
+    // Default diagnostic description for a token in container-backed streams.
+    template<typename value_type>
+    std::string default_token_value(const value_type &value) {
+        if constexpr (std::is_convertible_v<value_type, std::string>) {
+            return (std::string) value;
+        } else {
+            return "TOK";
+        }
+    }
+
     template<typename container_type>
     class container_stream : public base_token_stream<typename container_type::value_type,container_stream<container_type>> {
         friend class base_token_stream<typename container_type::value_type,container_stream<container_type>>;
@@ -182,16 +421,20 @@ namespace pkuyo::parsers {
         }
 
 
-        std::string pos_impl() {
-            return std::format("index: {}",position);
+        size_t offset_impl() const {
+            return position;
+        }
+
+        std::string pos_impl(size_t offset) const {
+            return std::format("index: {}",offset);
         }
 
         void seek_impl(size_t length) {
             position += length;
         }
 
-        std::string value_impl() {
-            return value_func(source[position]);
+        std::string value_impl(size_t offset) {
+            return value_func(source[offset]);
         }
 
         auto save_impl() {
@@ -202,14 +445,13 @@ namespace pkuyo::parsers {
             position = state;
         }
 
+        std::span<const value_type> window_impl(size_t length) const {
+            size_t start = std::min(position, source.size());
+            return {std::ranges::data(source) + start, std::min(length, source.size() - start)};
+        }
+
     public:
-        container_stream(const container_type &vec) : source(vec), value_func([](const value_type &value) -> std::string {
-            if constexpr (std::is_convertible_v<value_type, std::string>) {
-                return (std::string) value;
-            } else {
-                return "TOK";
-            }
-        }) {}
+        container_stream(const container_type &vec) : source(vec), value_func(default_token_value<value_type>) {}
 
         container_stream(const container_type &vec,  std::string(*_value_func)(const value_type &)) : source(vec), value_func(_value_func){}
 
@@ -222,223 +464,176 @@ namespace pkuyo::parsers {
             this->name = _name;
         }
 
-        std::string (*value_func)(const value_type &);
+        // Takes ownership of the tokens instead of copying them.
+        container_stream(container_type &&vec) : source(std::move(vec)), value_func(default_token_value<value_type>) {}
 
+        container_stream(container_type &&vec,  std::string(*_value_func)(const value_type &)) : source(std::move(vec)), value_func(_value_func){}
 
-    };
+        container_stream(container_type &&vec, std::string_view _name) : container_stream(std::move(vec)) {
+            this->name = _name;
+        }
 
+        container_stream(container_type &&vec, std::string(*_value_func)(const value_type &),
+                         std::string_view _name) : container_stream(std::move(vec), _value_func) {
+            this->name = _name;
+        }
 
-    class file_stream : public base_token_stream<char, file_stream> {
-        friend class base_token_stream<char, file_stream>;
+        std::string (*value_func)(const value_type &);
 
-        struct snap_shot {
-            std::streampos fstream_pos;
-            long long file_pos;
-            size_t buffer_pos;
-            size_t line;
-            size_t column;
-        };
-        std::ifstream file;
-        std::deque<char> buffer;
-        long long position = 0;
-        long long file_pos = 0;
 
-        size_t column = 0;
-        size_t line = 1;
+    };
 
-        std::unique_ptr<char[]> file_buffer;
 
-        char get_char() {
+    // Non-owning counterpart of container_stream.
+    //  Borrows the tokens of any contiguous range through std::span instead of copying the container,
+    //  so the underlying storage must outlive the stream.
+    template<typename value_type>
+    class span_stream : public base_token_stream<value_type,span_stream<value_type>> {
+        friend class base_token_stream<value_type,span_stream<value_type>>;
 
-            if (position >= file_pos + buffer.size()) {
-                const size_t chunk_size = 4096;
-                std::vector<char> temp(chunk_size);
-                file.read(temp.data(), chunk_size);
-                size_t actually_read = file.gcount();
+        std::span<const value_type> source;
+        size_t position = 0;
 
-                for (size_t i = 0; i < actually_read; ++i) {
-                    char c = temp[i];
-                    if (c == '\n') {
-                        ++line;
-                        column = 0;
-                    } else {
-                        ++column;
-                    }
-                    buffer.push_back(c);
-                }
-            }
+        value_type get_impl() {
+            return position < source.size() ? source[position++] : value_type{};
+        }
 
-            if (position < file_pos + buffer.size()) {
-                return buffer[position++ - file_pos];
-            }
+        value_type peek_impl(size_t lookahead) {
+            return (position + lookahead) < source.size() ?
+                   source[position + lookahead] : value_type{};
+        }
 
-            return EOF;
+        bool eof_impl(size_t lookahead) const {
+            return position + lookahead >= source.size();
         }
 
-        void fill_buffer(size_t required) {
-            while (buffer.size() < required + (position - file_pos) && !file.eof()) {
-                const size_t chunk_size = 4096;
-                std::vector<char> temp(chunk_size);
-                file.read(temp.data(), chunk_size);
-                size_t actually_read = file.gcount();
-
-                for (size_t i = 0; i < actually_read; ++i) {
-                    char c = temp[i];
-                    buffer.push_back(c);
-                    if (c == '\n') {
-                        ++line;
-                        column = 0;
-                    } else {
-                        ++column;
-                    }
-                }
-            }
+
+        size_t offset_impl() const {
+            return position;
         }
 
-        char get_impl() {
-            if (position < file_pos + buffer.size()) {
-                return buffer[position++ - file_pos];
-            }
+        std::string pos_impl(size_t offset) const {
+            return std::format("index: {}",offset);
+        }
 
-            char c = get_char();
-            if (c != EOF) {
-                file_pos = position++;
-            }
-            return c;
+        void seek_impl(size_t length) {
+            position += length;
         }
 
-        char peek_impl(size_t lookahead) {
-            fill_buffer(lookahead + 1);
-            if (position + lookahead >= file_pos + buffer.size()) {
-                return EOF;
-            }
-            return buffer[position + lookahead - file_pos];
+        std::string value_impl(size_t offset) {
+            return value_func(source[offset]);
         }
 
-        bool eof_impl(size_t lookahead) {
-            fill_buffer(lookahead + 1);
-            return position + lookahead >= file_pos + buffer.size();
+        auto save_impl() {
+            return position;
         }
 
-        std::string pos_impl() {
-            return std::format(" [line:{} , column: {}]", line, column);
+        auto restore_impl(auto&& state) {
+            position = state;
         }
 
-        void seek_impl(size_t length) {
-            position += length;
+        std::span<const value_type> window_impl(size_t length) const {
+            size_t start = std::min(position, source.size());
+            return source.subspan(start, std::min(length, source.size() - start));
         }
 
-        std::string value_impl() {
-            return std::string(1, peek_impl(0));
+    public:
+        span_stream(std::span<const value_type> tokens) : source(tokens), value_func(default_token_value<value_type>) {}
+
+        span_stream(std::span<const value_type> tokens, std::string(*_value_func)(const value_type &))
+                : source(tokens), value_func(_value_func) {}
+
+        span_stream(std::span<const value_type> tokens, std::string_view _name) : span_stream(tokens) {
+            this->name = _name;
         }
 
-        snap_shot save_impl() {
-            return {
-                    file.tellg(),
-                    file_pos,
-                    size_t(position - file_pos),
-                    line,
-                    column
-            };
-        }
-        void restore_impl(const snap_shot& state) {
-            if(state.buffer_pos + state.file_pos - file_pos < buffer.size()) {
-                position = file_pos + state.buffer_pos;
-            }
-            else {
-                file.seekg(state.fstream_pos);
-                if (!file.good()) {
-                    throw std::runtime_error("Failed to seek during restore");
-                }
-                buffer.clear();
-                file_pos = state.file_pos;
-                position = file_pos + state.buffer_pos;
-            }
-            line = state.line;
-            column = state.column;
+        span_stream(std::span<const value_type> tokens, std::string(*_value_func)(const value_type &),
+                    std::string_view _name) : span_stream(tokens, _value_func) {
+            this->name = _name;
         }
 
+        std::string (*value_func)(const value_type &);
+
+    };
+
+
+    // Thrown by push_stream when a parser looks past the input received so far before `Finish()` was called.
+    //  Caught by the incremental driver (see ParseIncremental), which waits for more input and retries.
+    class need_more_input : public std::exception {
     public:
-        explicit file_stream(const std::string &filename) : file() {
-            name = filename;
+        explicit need_more_input(size_t _required = 0) : required(_required) {}
 
-            //set file buffer
-            const size_t buffer_size = 32768;
-            file_buffer = std::make_unique<char[]>(buffer_size);
-            file.rdbuf()->pubsetbuf(file_buffer.get(), buffer_size);
+        [[nodiscard]] const char *what() const noexcept override {
+            return "need more input";
+        }
 
-            file.open(filename, std::ios::binary);
-            if (!file.is_open()) {
-                throw std::runtime_error("Failed to open file: " + filename);
-            }
+        // Absolute offset the received input must reach before the failed read can succeed.
+        [[nodiscard]] size_t Required() const noexcept {
+            return required;
         }
 
-        file_stream(const file_stream&) = delete;
-        file_stream& operator=(const file_stream&) = delete;
+    private:
+        size_t required;
     };
 
-    template<typename container_type>
-    auto ContainerStream(const container_type & input) {
-        return container_stream<container_type>(input);
-    }
 
-#ifdef IS_WINDOWS
+    // Token stream fed incrementally by the caller (e.g. chunks read from a pipe or socket).
+    //  `Feed()` appends tokens and `Finish()` marks the end of the input. Until then, looking past the received tokens
+    //  throws `need_more_input` instead of reporting EOF, and `Discard()` releases tokens that were already consumed,
+    //  so memory is bounded by the record being parsed rather than the whole input.
+    template<typename token_type>
+    class push_stream : public base_token_stream<token_type,push_stream<token_type>> {
+        friend class base_token_stream<token_type,push_stream<token_type>>;
 
-    class mmap_file_stream : public base_token_stream<char, mmap_file_stream> {
-        friend class base_token_stream<char, mmap_file_stream>;
+        std::vector<token_type> buffer;
 
-        HANDLE file_handle = INVALID_HANDLE_VALUE;
-        HANDLE mapping_handle = nullptr;
-        char* mapped_data = nullptr;
-        size_t file_size = 0;
+        // Absolute offset of buffer[0], and absolute offset of the read cursor.
+        size_t buffer_begin = 0;
         size_t position = 0;
+        bool finished = false;
 
-        size_t column = 1;
-        size_t line = 1;
+        size_t buffer_end() const {
+            return buffer_begin + buffer.size();
+        }
 
-        char get_impl() {
-            if (position >= file_size) {
-                throw std::runtime_error("Read beyond end of file");
-            }
+        // Throws `need_more_input` if `count` tokens from the cursor may still arrive.
+        void require(size_t count) const {
+            if (!finished && position + count > buffer_end())
+                throw need_more_input(position + count);
+        }
 
-            char c = mapped_data[position++];
+        token_type get_impl() {
+            require(1);
+            return position < buffer_end() ? buffer[position++ - buffer_begin] : token_type{};
+        }
 
-            if (c == '\n') {
-                line++;
-                column = 1;
-            } else {
-                column++;
-            }
-            return c;
+        token_type peek_impl(size_t lookahead) {
+            require(lookahead + 1);
+            return position + lookahead < buffer_end() ? buffer[position + lookahead - buffer_begin] : token_type{};
         }
 
-        char peek_impl(size_t lookahead) {
-            if (position + lookahead >= file_size) {
-                return 0;
-            }
-            return mapped_data[position + lookahead];
+        bool eof_impl(size_t lookahead) const {
+            require(lookahead + 1);
+            return position + lookahead >= buffer_end();
         }
 
-        bool eof_impl(size_t lookahead) {
-            return position + lookahead >= file_size;
+        size_t offset_impl() const {
+            return position;
         }
 
-        std::string pos_impl() {
-            return std::format(" [line:{} , column: {}]", line, column);
+        std::string pos_impl(size_t offset) const {
+            return std::format("index: {}",offset);
         }
 
         void seek_impl(size_t length) {
             position += length;
-            if (position > file_size) {
-                position = file_size;
-            }
         }
 
-        std::string value_impl() {
-            if (position == 0 || position > file_size) {
+        // Tokens released by `Discard()` render as an empty string.
+        std::string value_impl(size_t offset) {
+            if (offset < buffer_begin || offset >= buffer_end())
                 return "";
-            }
-            return std::string(1, mapped_data[position - 1]);
+            return value_func(buffer[offset - buffer_begin]);
         }
 
         auto save_impl() {
@@ -449,49 +644,568 @@ namespace pkuyo::parsers {
             position = state;
         }
 
+        std::span<const token_type> window_impl(size_t length) const {
+            require(length);
+            size_t start = std::min(position, buffer_end()) - buffer_begin;
+            return {buffer.data() + start, std::min(length, buffer.size() - start)};
+        }
 
     public:
-        explicit mmap_file_stream(const std::string& filename) {
-            name = filename;
+        push_stream() : value_func(default_token_value<token_type>) {}
 
-            file_handle = CreateFileA(
-                filename.c_str(),
-                GENERIC_READ,
-                FILE_SHARE_READ,
-                nullptr,
-                OPEN_EXISTING,
-                FILE_ATTRIBUTE_NORMAL,
-                nullptr
-            );
+        explicit push_stream(std::string_view _name) : push_stream() {
+            this->name = _name;
+        }
 
-            if (file_handle == INVALID_HANDLE_VALUE) {
-                throw std::runtime_error("Failed to open file: " + filename);
-            }
+        push_stream(std::string(*_value_func)(const token_type &), std::string_view _name = "")
+                : value_func(_value_func) {
+            this->name = _name;
+        }
 
-            LARGE_INTEGER size;
-            if (!GetFileSizeEx(file_handle, &size)) {
-                CloseHandle(file_handle);
-                throw std::runtime_error("Failed to get file size: " + filename);
-            }
-            file_size = static_cast<size_t>(size.QuadPart);
+        push_stream(const push_stream&) = delete;
+        push_stream& operator=(const push_stream&) = delete;
 
-            if (file_size == 0) {
-                CloseHandle(file_handle);
-                return;
-            }
+        // Appends the next chunk of input.
+        void Feed(std::span<const token_type> tokens) {
+            if (finished)
+                throw std::logic_error("push_stream: Feed() after Finish()");
+            buffer.insert(buffer.end(), tokens.begin(), tokens.end());
+        }
 
-            mapping_handle = CreateFileMapping(
-                file_handle,
-                nullptr,
-                PAGE_READONLY,
-                0,
-                0,
-                nullptr
-            );
+        void Feed(const token_type *tokens, size_t size) {
+            Feed(std::span<const token_type>(tokens, size));
+        }
 
-            if (mapping_handle == nullptr) {
-                CloseHandle(file_handle);
-                throw std::runtime_error("Failed to create file mapping: " + filename);
+        // Appends a null-terminated string (without the terminator).
+        void Feed(const token_type *str) requires std::is_same_v<token_type, char> || std::is_same_v<token_type, wchar_t> {
+            Feed(str, std::char_traits<token_type>::length(str));
+        }
+
+        // Marks the end of the input: from now on, reading past the received tokens reports EOF.
+        void Finish() {
+            finished = true;
+        }
+
+        [[nodiscard]] bool Finished() const {
+            return finished;
+        }
+
+        // Number of received tokens after the cursor.
+        [[nodiscard]] size_t Available() const {
+            return buffer_end() - std::min(position, buffer_end());
+        }
+
+        // Releases the tokens before the cursor. Snapshots taken before this call can no longer be restored.
+        void Discard() {
+            size_t consumed = std::min(position, buffer_end()) - buffer_begin;
+            // Shifting only once the dead prefix dominates keeps the cost amortized O(1) per token.
+            if (consumed == 0 || consumed < buffer.size() / 2)
+                return;
+            buffer.erase(buffer.begin(), buffer.begin() + (std::ptrdiff_t) consumed);
+            buffer_begin += consumed;
+        }
+
+        std::string (*value_func)(const token_type &);
+    };
+
+
+    // Resolves source offsets into line / column pairs on demand.
+    //  Streams only track an offset on the hot path; newlines are located in bulk with a vectorized scan
+    //  when a position is actually requested (or, for buffered streams, right before data is discarded).
+    class line_index {
+    public:
+        // Indexes the next `size` tokens of the source, which must directly follow the ones indexed so far.
+        template<typename char_type>
+        void append(const char_type *data, size_t size) {
+            if constexpr (sizeof(char_type) == 1) {
+                simd::scan_bytes(reinterpret_cast<const char *>(data), size, '\n', [this](size_t index) {
+                    newlines.push_back(scanned + index);
+                });
+            } else {
+                for (size_t i = 0; i < size; i++) {
+                    if (data[i] == char_type('\n'))
+                        newlines.push_back(scanned + i);
+                }
+            }
+            scanned += size;
+        }
+
+        // Number of leading tokens already indexed.
+        [[nodiscard]] size_t indexed() const {
+            return scanned;
+        }
+
+        // Returns the 1-based line and column of `offset`.
+        [[nodiscard]] std::pair<size_t, size_t> locate(size_t offset) const {
+            auto it = std::lower_bound(newlines.begin(), newlines.end(), offset);
+            size_t line = dropped_lines + (it - newlines.begin()) + 1;
+            size_t line_start = it == newlines.begin() ? dropped_line_start : *std::prev(it) + 1;
+            return {line, offset - line_start + 1};
+        }
+
+        // Forgets the individual newlines before `offset`, keeping only their count.
+        // Offsets before `offset` can no longer be located afterwards.
+        void compact(size_t offset) {
+            auto it = std::lower_bound(newlines.begin(), newlines.end(), offset);
+            if (it - newlines.begin() < compact_threshold)
+                return;
+            dropped_lines += it - newlines.begin();
+            dropped_line_start = *std::prev(it) + 1;
+            newlines.erase(newlines.begin(), it);
+        }
+
+    private:
+        static constexpr long compact_threshold = 4096;
+
+        std::vector<size_t> newlines;
+        size_t scanned = 0;
+        size_t dropped_lines = 0;
+        size_t dropped_line_start = 0;
+    };
+
+
+    // Reads a file synchronously on the parsing thread.
+    class file_reader {
+    public:
+        explicit file_reader(const std::string &filename) {
+            // Reads go straight into the caller's buffer, the stream's own buffer would only add a copy.
+            file.rdbuf()->pubsetbuf(nullptr, 0);
+
+            file.open(filename, std::ios::binary);
+            if (!file.is_open()) {
+                throw std::runtime_error("Failed to open file: " + filename);
+            }
+        }
+
+        // Reads up to `size` bytes, returning 0 only at the end of the file.
+        size_t read(char *data, size_t size) {
+            file.read(data, (std::streamsize) size);
+            return file.gcount();
+        }
+
+    private:
+        std::ifstream file;
+    };
+
+
+    // Reads a file ahead of the parser on a dedicated I/O thread.
+    //  The thread keeps up to `block_count` blocks of `block_size` bytes filled, so the parsing thread
+    //  only waits when it consumes data faster than the disk delivers it.
+    class prefetch_file_reader {
+    public:
+        static constexpr size_t default_block_size = 1 << 16;
+        static constexpr size_t default_block_count = 4;
+
+        explicit prefetch_file_reader(const std::string &filename, size_t _block_size = default_block_size,
+                                      size_t _block_count = default_block_count)
+                : file(filename), block_size(std::max<size_t>(_block_size, 1)), blocks(std::max<size_t>(_block_count, 2)) {
+            for (auto &block: blocks)
+                block.data = std::make_unique<char[]>(block_size);
+            worker = std::thread([this] { run(); });
+        }
+
+        ~prefetch_file_reader() {
+            {
+                std::lock_guard lock(mutex);
+                stopping = true;
+            }
+            producer_ready.notify_one();
+            worker.join();
+        }
+
+        prefetch_file_reader(const prefetch_file_reader &) = delete;
+        prefetch_file_reader &operator=(const prefetch_file_reader &) = delete;
+
+        // Reads up to `size` bytes, returning 0 only at the end of the file.
+        size_t read(char *data, size_t size) {
+            std::unique_lock lock(mutex);
+            consumer_ready.wait(lock, [this] { return ready_count > 0 || reached_end; });
+            if (ready_count == 0)
+                return 0;
+            lock.unlock();
+
+            // The worker never writes a block that is ready, so the copy needs no lock.
+            auto &block = blocks[head];
+            size_t count = std::min(size, block.size - consumed);
+            std::memcpy(data, block.data.get() + consumed, count);
+            consumed += count;
+
+            if (consumed == block.size) {
+                lock.lock();
+                head = (head + 1) % blocks.size();
+                --ready_count;
+                consumed = 0;
+                lock.unlock();
+                producer_ready.notify_one();
+            }
+            return count;
+        }
+
+    private:
+        struct block {
+            std::unique_ptr<char[]> data;
+            size_t size = 0;
+        };
+
+        void run() {
+            std::unique_lock lock(mutex);
+            while (true) {
+                producer_ready.wait(lock, [this] {
+                    return stopping || (!reached_end && ready_count < blocks.size());
+                });
+                if (stopping)
+                    return;
+
+                size_t slot = (head + ready_count) % blocks.size();
+                lock.unlock();
+
+                size_t actually_read = file.read(blocks[slot].data.get(), block_size);
+
+                lock.lock();
+                if (actually_read == 0) {
+                    reached_end = true;
+                } else {
+                    blocks[slot].size = actually_read;
+                    ++ready_count;
+                }
+                consumer_ready.notify_one();
+            }
+        }
+
+        file_reader file;
+        size_t block_size;
+        std::vector<block> blocks;
+
+        std::mutex mutex;
+        std::condition_variable producer_ready;
+        std::condition_variable consumer_ready;
+
+        // Ring of prefetched blocks: `ready_count` blocks starting at `head` are filled.
+        size_t head = 0;
+        size_t ready_count = 0;
+        size_t consumed = 0;
+        bool reached_end = false;
+        bool stopping = false;
+
+        std::thread worker;
+    };
+
+
+    // Buffered file stream.
+    //  Bytes are read with large reads straight into a power-of-two ring buffer,
+    //  so memory stays bounded by the buffer capacity rather than the file size.
+    //  Data behind the oldest outstanding `Save()` snapshot is discarded as the parse moves forward;
+    //  data after it stays resident (growing the ring if needed), so `Restore()` never touches the file.
+    //  `reader_type` supplies the bytes (see file_reader and prefetch_file_reader).
+    template<typename reader_type>
+    class basic_file_stream : public base_token_stream<char, basic_file_stream<reader_type>> {
+        friend class base_token_stream<char, basic_file_stream<reader_type>>;
+
+    public:
+        // Snapshot returned by `Save()`. Keeps the buffered bytes from its offset onward resident while alive.
+        class snap_shot {
+            friend class basic_file_stream;
+
+            snap_shot(basic_file_stream *_stream, long long _offset) : stream(_stream), offset(_offset) {
+                stream->pin(offset);
+            }
+
+            basic_file_stream *stream;
+            long long offset;
+
+        public:
+            snap_shot(snap_shot &&other) noexcept : stream(std::exchange(other.stream, nullptr)), offset(other.offset) {}
+
+            snap_shot(const snap_shot &) = delete;
+            snap_shot &operator=(const snap_shot &) = delete;
+
+            ~snap_shot() {
+                if (stream)
+                    stream->unpin();
+            }
+        };
+
+    private:
+        static constexpr size_t default_buffer_size = 1 << 16;
+
+        reader_type reader;
+        std::unique_ptr<char[]> buffer;
+        size_t capacity = 0;
+        size_t mask = 0;
+
+        // File offsets of the oldest resident byte, one past the newest resident byte, and the read cursor.
+        long long buffer_begin = 0;
+        long long buffer_end = 0;
+        long long position = 0;
+        bool file_end = false;
+
+        // Outstanding snapshots and the lowest offset any of them may restore to.
+        size_t pin_count = 0;
+        long long pin_floor = 0;
+
+        line_index lines;
+
+        char get_impl() {
+            if (position < buffer_end || fill_buffer(1))
+                return buffer[position++ & mask];
+            return EOF;
+        }
+
+        char peek_impl(size_t lookahead) {
+            if (position + (long long) lookahead < buffer_end || fill_buffer(lookahead + 1))
+                return buffer[(position + lookahead) & mask];
+            return EOF;
+        }
+
+        bool eof_impl(size_t lookahead) {
+            return position + (long long) lookahead >= buffer_end && !fill_buffer(lookahead + 1);
+        }
+
+        // Slow path: reads until `required` bytes from the cursor are resident or the file ends.
+        bool fill_buffer(size_t required) {
+            const long long target = position + (long long) required;
+            if (required > capacity)
+                grow(std::bit_ceil(required));
+
+            while (buffer_end < target && !file_end) {
+                long long keep_from = pin_count ? std::min(pin_floor, position) : position;
+                keep_from = std::clamp(keep_from, buffer_begin, buffer_end);
+
+                if (target - keep_from > (long long) capacity)
+                    grow(std::bit_ceil((size_t) (target - keep_from)));
+                if (keep_from > buffer_begin) {
+                    index_lines(keep_from);
+                    buffer_begin = keep_from;
+                }
+
+                size_t used = buffer_end - buffer_begin;
+                size_t offset = buffer_end & mask;
+                size_t chunk = std::min(capacity - used, capacity - offset);
+
+                size_t actually_read = reader.read(buffer.get() + offset, chunk);
+                buffer_end += (long long) actually_read;
+                if (actually_read == 0)
+                    file_end = true;
+            }
+            return buffer_end >= target;
+        }
+
+        void grow(size_t new_capacity) {
+            auto new_buffer = std::make_unique<char[]>(new_capacity);
+            for (long long i = buffer_begin; i < buffer_end; i++)
+                new_buffer[i & (new_capacity - 1)] = buffer[i & mask];
+            buffer = std::move(new_buffer);
+            capacity = new_capacity;
+            mask = new_capacity - 1;
+        }
+
+        // Feeds the resident bytes up to `offset` into the newline index before they can be discarded.
+        void index_lines(long long offset) {
+            while ((long long) lines.indexed() < offset) {
+                long long from = lines.indexed();
+                size_t begin = from & mask;
+                size_t size = std::min<size_t>(offset - from, capacity - begin);
+                lines.append(buffer.get() + begin, size);
+            }
+            lines.compact(pin_count ? std::min(pin_floor, buffer_begin) : buffer_begin);
+        }
+
+        void pin(long long offset) {
+            if (pin_count++ == 0 || offset < pin_floor)
+                pin_floor = offset;
+        }
+
+        void unpin() {
+            --pin_count;
+        }
+
+        size_t offset_impl() const {
+            return position;
+        }
+
+        std::string pos_impl(size_t offset) {
+            if ((long long) offset > buffer_end && (long long) offset >= position)
+                fill_buffer(offset - position);
+            index_lines(std::min((long long) offset, buffer_end));
+            auto [line, column] = lines.locate(offset);
+            return std::format(" [line:{} , column: {}]", line, column);
+        }
+
+        void seek_impl(size_t length) {
+            position += (long long) length;
+        }
+
+        // Bytes that have left the ring buffer render as an empty string.
+        std::string value_impl(size_t offset) {
+            long long at = (long long) offset;
+            if (at >= buffer_end && at >= position)
+                fill_buffer(at - position + 1);
+            if (at < buffer_begin || at >= buffer_end)
+                return "";
+            return std::string(1, buffer[at & mask]);
+        }
+
+        snap_shot save_impl() {
+            return {this, position};
+        }
+
+        // Everything from a live snapshot onward is still resident, so restoring only moves the cursor.
+        void restore_impl(const snap_shot &state) {
+            position = state.offset;
+        }
+
+    public:
+        // Extra arguments are forwarded to the reader after the file name.
+        template<typename... reader_args>
+        explicit basic_file_stream(const std::string &filename, size_t buffer_size = default_buffer_size, reader_args&&... args)
+                : reader(filename, std::forward<reader_args>(args)...) {
+            this->name = filename;
+
+            capacity = std::bit_ceil(std::max<size_t>(buffer_size, 64));
+            mask = capacity - 1;
+            buffer = std::make_unique<char[]>(capacity);
+        }
+
+        basic_file_stream(const basic_file_stream&) = delete;
+        basic_file_stream& operator=(const basic_file_stream&) = delete;
+    };
+
+    using file_stream = basic_file_stream<file_reader>;
+
+    // File stream whose reads are overlapped with parsing by a background thread.
+    using prefetch_file_stream = basic_file_stream<prefetch_file_reader>;
+
+    template<typename container_type>
+    auto ContainerStream(const container_type & input) {
+        return container_stream<container_type>(input);
+    }
+
+    template<typename container_type>
+    requires (!std::is_lvalue_reference_v<container_type>)
+    auto ContainerStream(container_type && input) {
+        return container_stream<container_type>(std::move(input));
+    }
+
+    // Creates a span_stream borrowing the elements of a contiguous range.
+    template<std::ranges::contiguous_range range_type>
+    auto SpanStream(const range_type & input) {
+        return span_stream<std::ranges::range_value_t<range_type>>(std::span(std::ranges::data(input),std::ranges::size(input)));
+    }
+
+#ifdef IS_WINDOWS
+
+    class mmap_file_stream : public base_token_stream<char, mmap_file_stream> {
+        friend class base_token_stream<char, mmap_file_stream>;
+
+        HANDLE file_handle = INVALID_HANDLE_VALUE;
+        HANDLE mapping_handle = nullptr;
+        char* mapped_data = nullptr;
+        size_t file_size = 0;
+        size_t position = 0;
+
+        line_index lines;
+
+        char get_impl() {
+            if (position >= file_size) {
+                throw std::runtime_error("Read beyond end of file");
+            }
+
+            return mapped_data[position++];
+        }
+
+        char peek_impl(size_t lookahead) {
+            if (position + lookahead >= file_size) {
+                return 0;
+            }
+            return mapped_data[position + lookahead];
+        }
+
+        bool eof_impl(size_t lookahead) {
+            return position + lookahead >= file_size;
+        }
+
+        size_t offset_impl() const {
+            return position;
+        }
+
+        std::string pos_impl(size_t offset) {
+            offset = std::min(offset, file_size);
+            if (lines.indexed() < offset)
+                lines.append(mapped_data + lines.indexed(), offset - lines.indexed());
+            auto [line, column] = lines.locate(offset);
+            return std::format(" [line:{} , column: {}]", line, column);
+        }
+
+        void seek_impl(size_t length) {
+            position += length;
+            if (position > file_size) {
+                position = file_size;
+            }
+        }
+
+        std::string value_impl(size_t offset) {
+            if (offset == 0 || offset > file_size) {
+                return "";
+            }
+            return std::string(1, mapped_data[offset - 1]);
+        }
+
+        auto save_impl() {
+            return position;
+        }
+
+        auto restore_impl(auto&& state) {
+            position = state;
+        }
+
+        std::span<const char> window_impl(size_t length) const {
+            size_t start = std::min(position, file_size);
+            return {mapped_data + start, std::min(length, file_size - start)};
+        }
+
+
+    public:
+        explicit mmap_file_stream(const std::string& filename) {
+            name = filename;
+
+            file_handle = CreateFileA(
+                filename.c_str(),
+                GENERIC_READ,
+                FILE_SHARE_READ,
+                nullptr,
+                OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL,
+                nullptr
+            );
+
+            if (file_handle == INVALID_HANDLE_VALUE) {
+                throw std::runtime_error("Failed to open file: " + filename);
+            }
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file_handle, &size)) {
+                CloseHandle(file_handle);
+                throw std::runtime_error("Failed to get file size: " + filename);
+            }
+            file_size = static_cast<size_t>(size.QuadPart);
+
+            if (file_size == 0) {
+                CloseHandle(file_handle);
+                return;
+            }
+
+            mapping_handle = CreateFileMapping(
+                file_handle,
+                nullptr,
+                PAGE_READONLY,
+                0,
+                0,
+                nullptr
+            );
+
+            if (mapping_handle == nullptr) {
+                CloseHandle(file_handle);
+                throw std::runtime_error("Failed to create file mapping: " + filename);
             }
 
             mapped_data = static_cast<char*>(MapViewOfFile(
@@ -535,23 +1249,14 @@ namespace pkuyo::parsers {
         size_t file_size = 0;
         size_t position = 0;
 
-        size_t column = 1;
-        size_t line = 1;
+        line_index lines;
 
         char get_impl() {
             if (position >= file_size) {
                 throw std::runtime_error("Read beyond end of file");
             }
 
-            char c = mapped_data[position++];
-
-            if (c == '\n') {
-                line++;
-                column = 1;
-            } else {
-                column++;
-            }
-            return c;
+            return mapped_data[position++];
         }
 
         char peek_impl(size_t lookahead) {
@@ -565,7 +1270,15 @@ namespace pkuyo::parsers {
             return position + lookahead >= file_size;
         }
 
-        std::string pos_impl() {
+        size_t offset_impl() const {
+            return position;
+        }
+
+        std::string pos_impl(size_t offset) {
+            offset = std::min(offset, file_size);
+            if (lines.indexed() < offset)
+                lines.append(mapped_data + lines.indexed(), offset - lines.indexed());
+            auto [line, column] = lines.locate(offset);
             return std::format(" [line:{} , column: {}]", line, column);
         }
 
@@ -576,11 +1289,11 @@ namespace pkuyo::parsers {
             }
         }
 
-        std::string value_impl() {
-            if (position == 0) {
+        std::string value_impl(size_t offset) {
+            if (offset == 0) {
                 return "";
             }
-            return std::string(1, mapped_data[position - 1]);
+            return std::string(1, mapped_data[offset - 1]);
         }
 
         auto save_impl() {
@@ -591,6 +1304,11 @@ namespace pkuyo::parsers {
             position = state;
         }
 
+        std::span<const char> window_impl(size_t length) const {
+            size_t start = std::min(position, file_size);
+            return {mapped_data + start, std::min(length, file_size - start)};
+        }
+
 
     public:
         explicit mmap_file_stream(const std::string &filename) {
@@ -641,6 +1359,994 @@ namespace pkuyo::parsers {
 
         mmap_file_stream &operator=(const mmap_file_stream &) = delete;
     };
-#endif
+
+    // Memory-mapped file stream that maps a bounded window instead of the whole file.
+    //  The window is a page-aligned slice that moves with the parse; slices behind the cursor are unmapped
+    //  when it advances, and `Restore()` to an older offset simply maps that slice again.
+    //  In tail mode, reaching the end re-checks the file size, so a file that is still being appended can be followed.
+    class windowed_mmap_file_stream : public base_token_stream<char, windowed_mmap_file_stream> {
+        friend class base_token_stream<char, windowed_mmap_file_stream>;
+
+        static constexpr size_t default_window_size = 1 << 24;
+        static constexpr size_t index_block_size = 1 << 16;
+
+        int fd = -1;
+        size_t file_size = 0;
+        size_t position = 0;
+        bool tail = false;
+
+        size_t page_size = 0;
+        size_t window_size = 0;
+
+        // Current mapping: file bytes [map_begin, map_end).
+        char *mapped_data = nullptr;
+        size_t map_begin = 0;
+        size_t map_end = 0;
+
+        line_index lines;
+
+        char get_impl() {
+            if (position >= map_begin && position < map_end)
+                return mapped_data[position++ - map_begin];
+            if (!available(position + 1)) {
+                throw std::runtime_error("Read beyond end of file");
+            }
+            char token = *map(position, 1);
+            position++;
+            return token;
+        }
+
+        char peek_impl(size_t lookahead) {
+            size_t offset = position + lookahead;
+            if (offset >= map_begin && offset < map_end)
+                return mapped_data[offset - map_begin];
+            if (!available(offset + 1)) {
+                return 0;
+            }
+            // The window grows over the lookahead instead of leaving the cursor, which is read next.
+            return map(position, lookahead + 1)[lookahead];
+        }
+
+        bool eof_impl(size_t lookahead) {
+            return !available(position + lookahead + 1);
+        }
+
+        size_t offset_impl() const {
+            return position;
+        }
+
+        // Lines are indexed from blocks read with `pread()`, so rendering a position never moves the window.
+        std::string pos_impl(size_t offset) {
+            offset = std::min(offset, file_size);
+            if (lines.indexed() < offset) {
+                auto block = std::make_unique<char[]>(std::min(offset - lines.indexed(), index_block_size));
+                while (lines.indexed() < offset) {
+                    size_t from = lines.indexed();
+                    size_t length = std::min(offset - from, index_block_size);
+                    read_at(from, block.get(), length);
+                    lines.append(block.get(), length);
+                }
+            }
+            auto [line, column] = lines.locate(offset);
+            return std::format(" [line:{} , column: {}]", line, column);
+        }
+
+        void seek_impl(size_t length) {
+            position += length;
+        }
+
+        std::string value_impl(size_t offset) {
+            if (offset >= map_begin && offset < map_end)
+                return std::string(1, mapped_data[offset - map_begin]);
+            if (!available(offset + 1))
+                return "";
+            char token;
+            read_at(offset, &token, 1);
+            return std::string(1, token);
+        }
+
+        auto save_impl() {
+            return position;
+        }
+
+        auto restore_impl(auto&& state) {
+            position = state;
+        }
+
+        // The returned block stays valid until the stream reads outside the current window.
+        std::span<const char> window_impl(size_t length) {
+            if (!available(position + length))
+                length = file_size - std::min(position, file_size);
+            if (length == 0)
+                return {};
+            return {map(position, length), length};
+        }
+
+        // Checks that the file holds bytes up to `end`, re-reading its size in tail mode.
+        bool available(size_t end) {
+            if (end <= file_size)
+                return true;
+            if (tail)
+                Refresh();
+            return end <= file_size;
+        }
+
+        // Returns a pointer to file byte `offset`, remapping so that `[offset, offset + length)` is resident.
+        const char *map(size_t offset, size_t length) {
+            if (offset < map_begin || offset + length > map_end) {
+                unmap();
+                size_t begin = offset & ~(page_size - 1);
+                size_t end = std::min(file_size, std::max(offset + length, begin + window_size));
+
+                void *data = mmap(nullptr, end - begin, PROT_READ, MAP_PRIVATE, fd, (off_t) begin);
+                if (data == MAP_FAILED) {
+                    throw std::runtime_error("Failed to mmap file: " + name);
+                }
+                mapped_data = static_cast<char *>(data);
+                map_begin = begin;
+                map_end = end;
+
+                madvise(mapped_data, end - begin, MADV_SEQUENTIAL);
+                madvise(mapped_data, end - begin, MADV_WILLNEED);
+            }
+            return mapped_data + (offset - map_begin);
+        }
+
+        // Copies file bytes `[offset, offset + length)` into `buffer` without touching the mapping.
+        void read_at(size_t offset, char *buffer, size_t length) {
+            while (length > 0) {
+                ssize_t count = pread(fd, buffer, length, (off_t) offset);
+                if (count <= 0) {
+                    throw std::runtime_error("Failed to read file: " + name);
+                }
+                buffer += count;
+                offset += (size_t) count;
+                length -= (size_t) count;
+            }
+        }
+
+        void unmap() {
+            if (mapped_data != nullptr) {
+                munmap(mapped_data, map_end - map_begin);
+                mapped_data = nullptr;
+                map_begin = map_end = 0;
+            }
+        }
+
+    public:
+        // `window_size` is rounded up to whole pages. With `follow_growth`, the stream acts as a tailer.
+        explicit windowed_mmap_file_stream(const std::string &filename, size_t _window_size = default_window_size,
+                                           bool follow_growth = false) : tail(follow_growth) {
+            name = filename;
+
+            if ((fd = open(filename.c_str(), O_RDONLY)) == -1) {
+                throw std::runtime_error("Failed to open file: " + filename);
+            }
+
+            page_size = (size_t) sysconf(_SC_PAGESIZE);
+            window_size = (std::max<size_t>(_window_size, 1) + page_size - 1) & ~(page_size - 1);
+
+            try {
+                Refresh();
+            } catch (...) {
+                close(fd);
+                throw;
+            }
+        }
+
+        // Re-reads the file size. Returns true if the file grew.
+        bool Refresh() {
+            struct stat st;
+            if (fstat(fd, &st) == -1) {
+                throw std::runtime_error("Failed to get file size: " + name);
+            }
+            size_t new_size = st.st_size;
+            if (new_size <= file_size)
+                return false;
+            file_size = new_size;
+            return true;
+        }
+
+        ~windowed_mmap_file_stream() {
+            unmap();
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+
+        windowed_mmap_file_stream(const windowed_mmap_file_stream &) = delete;
+
+        windowed_mmap_file_stream &operator=(const windowed_mmap_file_stream &) = delete;
+    };
+#endif
+
+    // Marks streams whose upcoming tokens can be viewed as one contiguous block through `Window()`.
+    //  Matchers use it to compare literals with a single bounds check instead of a `Peek()` per token.
+    template<typename Stream>
+    struct is_contiguous_stream : std::false_type {};
+
+    template<typename char_type>
+    struct is_contiguous_stream<basic_string_stream<char_type>> : std::true_type {};
+
+    template<typename char_type>
+    struct is_contiguous_stream<basic_string_view_stream<char_type>> : std::true_type {};
+
+    template<typename value_type>
+    struct is_contiguous_stream<span_stream<value_type>> : std::true_type {};
+
+    template<typename token_type>
+    struct is_contiguous_stream<push_stream<token_type>> : std::true_type {};
+
+    template<typename container_type>
+    struct is_contiguous_stream<container_stream<container_type>>
+            : std::bool_constant<std::ranges::contiguous_range<container_type>> {};
+
+    template<>
+    struct is_contiguous_stream<mmap_file_stream> : std::true_type {};
+
+#ifndef IS_WINDOWS
+    template<>
+    struct is_contiguous_stream<windowed_mmap_file_stream> : std::true_type {};
+#endif
+
+    template<typename Stream>
+    constexpr bool is_contiguous_stream_v = is_contiguous_stream<std::decay_t<Stream>>::value;
+
+    // Marks contiguous streams whose `Window()` blocks stay valid until the stream (or the buffer it borrows)
+    //  is destroyed, so results may be returned as views into them. Streams that refill, remap or decode
+    //  into a scratch buffer (push_stream, windowed_mmap_file_stream, utf8_stream) do not qualify.
+    template<typename Stream>
+    struct has_stable_window : std::false_type {};
+
+    template<typename char_type>
+    struct has_stable_window<basic_string_stream<char_type>> : std::true_type {};
+
+    template<typename char_type>
+    struct has_stable_window<basic_string_view_stream<char_type>> : std::true_type {};
+
+    template<typename value_type>
+    struct has_stable_window<span_stream<value_type>> : std::true_type {};
+
+    template<typename container_type>
+    struct has_stable_window<container_stream<container_type>>
+            : std::bool_constant<std::ranges::contiguous_range<container_type>> {};
+
+    template<>
+    struct has_stable_window<mmap_file_stream> : std::true_type {};
+
+    template<typename Stream>
+    constexpr bool has_stable_window_v = has_stable_window<std::decay_t<Stream>>::value;
+
+
+    // Decodes a byte stream into Unicode code points (`char32_t` tokens).
+    //  Invalid or truncated UTF-8 (overlong forms, surrogates, values above U+10FFFF) throws std::runtime_error.
+    //  Contiguous sources are decoded a block at a time, with ASCII runs found by a vectorized scan and widened
+    //  without per-byte branches; other sources are decoded one sequence at a time.
+    //  Positions are byte offsets into the source, so diagnostics are rendered by the source stream.
+    template<typename source_type>
+    class utf8_stream : public base_token_stream<char32_t, utf8_stream<source_type>> {
+        friend class base_token_stream<char32_t, utf8_stream<source_type>>;
+
+    public:
+        // Snapshot returned by `Save()`. Keeps the code points from its index onward decoded while alive.
+        class snap_shot {
+            friend class utf8_stream;
+
+            snap_shot(utf8_stream *_stream, size_t _index) : stream(_stream), index(_index) {
+                stream->pin(index);
+            }
+
+            utf8_stream *stream;
+            size_t index;
+
+        public:
+            snap_shot(snap_shot &&other) noexcept : stream(std::exchange(other.stream, nullptr)), index(other.index) {}
+
+            snap_shot(const snap_shot &) = delete;
+            snap_shot &operator=(const snap_shot &) = delete;
+
+            ~snap_shot() {
+                if (stream)
+                    stream->unpin();
+            }
+        };
+
+    private:
+        static constexpr size_t block_size = 4096;
+
+        source_type &source;
+
+        // Decoded code points and the source byte offset of each; decoded[0] is code point number `decoded_begin`.
+        std::vector<char32_t> decoded;
+        std::vector<size_t> offsets;
+        size_t decoded_begin = 0;
+        size_t position = 0;
+
+        // Source byte offset of the first byte not decoded yet.
+        size_t byte_offset;
+
+        size_t pin_count = 0;
+        size_t pin_floor = 0;
+
+        size_t decoded_end() const {
+            return decoded_begin + decoded.size();
+        }
+
+        char32_t get_impl() {
+            if (fill(1))
+                return decoded[position++ - decoded_begin];
+            return char32_t{};
+        }
+
+        char32_t peek_impl(size_t lookahead) {
+            if (fill(lookahead + 1))
+                return decoded[position + lookahead - decoded_begin];
+            return char32_t{};
+        }
+
+        bool eof_impl(size_t lookahead) {
+            return !fill(lookahead + 1);
+        }
+
+        size_t offset_impl() {
+            return fill(1) ? offsets[position - decoded_begin] : byte_offset;
+        }
+
+        size_t index_impl() const {
+            return position;
+        }
+
+        std::string pos_impl(size_t offset) {
+            return source.Pos(source_position{offset, 0});
+        }
+
+        void seek_impl(size_t length) {
+            position += length;
+        }
+
+        // Positions are source byte offsets; code points no longer decoded render as an empty string.
+        std::string value_impl(size_t offset) {
+            fill(1);
+            auto it = std::lower_bound(offsets.begin(), offsets.end(), offset);
+            if (it == offsets.end() || *it != offset)
+                return "";
+            return encode(decoded[it - offsets.begin()]);
+        }
+
+        snap_shot save_impl() {
+            return {this, position};
+        }
+
+        void restore_impl(const snap_shot &state) {
+            position = state.index;
+        }
+
+        std::span<const char32_t> window_impl(size_t length) {
+            fill(length);
+            size_t start = std::min(position, decoded_end()) - decoded_begin;
+            return {decoded.data() + start, std::min(length, decoded.size() - start)};
+        }
+
+        void pin(size_t index) {
+            if (pin_count++ == 0 || index < pin_floor)
+                pin_floor = index;
+        }
+
+        void unpin() {
+            --pin_count;
+        }
+
+        // Decodes until `required` code points from the cursor are available or the source ends.
+        bool fill(size_t required) {
+            if (position + required <= decoded_end())
+                return true;
+            compact();
+            while (position + required > decoded_end()) {
+                if (!decode_more())
+                    return false;
+            }
+            return true;
+        }
+
+        // Drops decoded code points that neither the cursor nor a snapshot can return to.
+        void compact() {
+            size_t keep_from = std::min(pin_count ? std::min(pin_floor, position) : position, decoded_end());
+            size_t dead = keep_from - decoded_begin;
+            if (dead == 0 || dead < decoded.size() / 2)
+                return;
+            decoded.erase(decoded.begin(), decoded.begin() + (std::ptrdiff_t) dead);
+            offsets.erase(offsets.begin(), offsets.begin() + (std::ptrdiff_t) dead);
+            decoded_begin = keep_from;
+        }
+
+        void push(char32_t code_point, size_t offset) {
+            decoded.push_back(code_point);
+            offsets.push_back(offset);
+        }
+
+        bool decode_more() {
+            if constexpr (is_contiguous_stream_v<source_type>) {
+                auto window = source.Window(block_size);
+                if (window.empty())
+                    return false;
+                auto bytes = reinterpret_cast<const unsigned char *>(window.data());
+
+                size_t i = 0;
+                while (i < window.size()) {
+                    size_t ascii = simd::ascii_prefix(window.data() + i, window.size() - i);
+                    size_t count = decoded.size();
+                    decoded.resize(count + ascii);
+                    offsets.resize(count + ascii);
+                    for (size_t k = 0; k < ascii; k++, i++) {
+                        decoded[count + k] = bytes[i];
+                        offsets[count + k] = byte_offset + i;
+                    }
+                    if (i == window.size())
+                        break;
+
+                    size_t length = sequence_length(bytes[i], byte_offset + i);
+                    if (i + length > window.size()) {
+                        // A short window means the source ended inside the sequence.
+                        if (window.size() < block_size)
+                            throw_invalid(byte_offset + i);
+                        break;
+                    }
+                    push(decode_sequence(bytes + i, length, byte_offset + i), byte_offset + i);
+                    i += length;
+                }
+                source.Seek(i);
+                byte_offset += i;
+            } else {
+                if (source.Eof())
+                    return false;
+                unsigned char sequence[4];
+                sequence[0] = static_cast<unsigned char>(source.Get());
+                size_t length = sequence_length(sequence[0], byte_offset);
+                for (size_t i = 1; i < length; i++) {
+                    if (source.Eof())
+                        throw_invalid(byte_offset);
+                    sequence[i] = static_cast<unsigned char>(source.Get());
+                }
+                push(decode_sequence(sequence, length, byte_offset), byte_offset);
+                byte_offset += length;
+            }
+            return true;
+        }
+
+        [[noreturn]] static void throw_invalid(size_t offset) {
+            throw std::runtime_error(std::format("Invalid UTF-8 sequence at byte {}", offset));
+        }
+
+        static size_t sequence_length(unsigned char lead, size_t offset) {
+            if (lead < 0x80) return 1;
+            if (lead >= 0xC2 && lead <= 0xDF) return 2;
+            if (lead >= 0xE0 && lead <= 0xEF) return 3;
+            if (lead >= 0xF0 && lead <= 0xF4) return 4;
+            throw_invalid(offset);
+        }
+
+        // Decodes one sequence whose length was given by `sequence_length`, rejecting overlong forms and surrogates.
+        static char32_t decode_sequence(const unsigned char *bytes, size_t length, size_t offset) {
+            if (length == 1)
+                return bytes[0];
+
+            unsigned char low = 0x80, high = 0xBF;
+            if (bytes[0] == 0xE0) low = 0xA0;
+            else if (bytes[0] == 0xED) high = 0x9F;
+            else if (bytes[0] == 0xF0) low = 0x90;
+            else if (bytes[0] == 0xF4) high = 0x8F;
+            if (bytes[1] < low || bytes[1] > high)
+                throw_invalid(offset);
+
+            char32_t code_point = bytes[0] & (0x7F >> length);
+            for (size_t i = 1; i < length; i++) {
+                if ((bytes[i] & 0xC0) != 0x80)
+                    throw_invalid(offset);
+                code_point = (code_point << 6) | (bytes[i] & 0x3F);
+            }
+            return code_point;
+        }
+
+        static std::string encode(char32_t code_point) {
+            std::string result;
+            if (code_point < 0x80) {
+                result += static_cast<char>(code_point);
+            } else if (code_point < 0x800) {
+                result += static_cast<char>(0xC0 | (code_point >> 6));
+                result += static_cast<char>(0x80 | (code_point & 0x3F));
+            } else if (code_point < 0x10000) {
+                result += static_cast<char>(0xE0 | (code_point >> 12));
+                result += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+                result += static_cast<char>(0x80 | (code_point & 0x3F));
+            } else {
+                result += static_cast<char>(0xF0 | (code_point >> 18));
+                result += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+                result += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+                result += static_cast<char>(0x80 | (code_point & 0x3F));
+            }
+            return result;
+        }
+
+    public:
+        // Decodes `_source` from its current position. The source must outlive this stream
+        //  and should not be read directly while this stream is in use.
+        explicit utf8_stream(source_type &_source) : source(_source), byte_offset(_source.Position().offset) {
+            this->name = std::string(source.Name());
+        }
+
+        utf8_stream(const utf8_stream &) = delete;
+        utf8_stream &operator=(const utf8_stream &) = delete;
+    };
+
+    template<typename source_type>
+    struct is_contiguous_stream<utf8_stream<source_type>> : std::true_type {};
+
+    template<typename source_type>
+    auto Utf8Stream(source_type &source) {
+        return utf8_stream<source_type>(source);
+    }
+
+
+    // Token stream that lexes a character stream on demand.
+    //  `lexer` is a parser over the source producing one token per call; the optional `skip` parser
+    //  (e.g. whitespace and comments) runs before each token. Tokens are produced only when the parser looks at them
+    //  and kept in a small power-of-two ring that grows to the widest lookahead in use, so lexing overlaps with
+    //  parsing and memory does not grow with the input.
+    //  `Save()` / `Restore()` work on token indices; tokens after the oldest live snapshot stay in the ring.
+    //  Positions are the source offsets where tokens start, rendered by the source stream.
+    template<typename source_type, typename lexer_type, typename skip_type = std::nullptr_t>
+    class lexer_stream : public base_token_stream<
+            typename decltype(std::declval<const lexer_type &>().Parse(std::declval<source_type &>()))::value_type,
+            lexer_stream<source_type, lexer_type, skip_type>> {
+    public:
+        using value_type = typename decltype(std::declval<const lexer_type &>().Parse(std::declval<source_type &>()))::value_type;
+
+    private:
+        friend class base_token_stream<value_type, lexer_stream<source_type, lexer_type, skip_type>>;
+
+    public:
+        // Snapshot returned by `Save()`. Keeps the tokens from its index onward in the ring while alive.
+        class snap_shot {
+            friend class lexer_stream;
+
+            snap_shot(lexer_stream *_stream, size_t _index) : stream(_stream), index(_index) {
+                stream->pin(index);
+            }
+
+            lexer_stream *stream;
+            size_t index;
+
+        public:
+            snap_shot(snap_shot &&other) noexcept : stream(std::exchange(other.stream, nullptr)), index(other.index) {}
+
+            snap_shot(const snap_shot &) = delete;
+            snap_shot &operator=(const snap_shot &) = delete;
+
+            ~snap_shot() {
+                if (stream)
+                    stream->unpin();
+            }
+        };
+
+    private:
+        source_type &source;
+        lexer_type lexer;
+        skip_type skip;
+
+        // Ring of lexed tokens [ring_begin, ring_end) with the source offset of each, indexed by token number.
+        std::vector<value_type> tokens;
+        std::vector<size_t> offsets;
+        size_t mask = 0;
+        size_t ring_begin = 0;
+        size_t ring_end = 0;
+        size_t position = 0;
+        bool source_end = false;
+
+        size_t pin_count = 0;
+        size_t pin_floor = 0;
+
+        value_type get_impl() {
+            if (fill(1))
+                return tokens[position++ & mask];
+            return value_type{};
+        }
+
+        value_type peek_impl(size_t lookahead) {
+            if (fill(lookahead + 1))
+                return tokens[(position + lookahead) & mask];
+            return value_type{};
+        }
+
+        bool eof_impl(size_t lookahead) {
+            return !fill(lookahead + 1);
+        }
+
+        size_t offset_impl() {
+            return fill(1) ? offsets[position & mask] : source.Position().offset;
+        }
+
+        size_t index_impl() const {
+            return position;
+        }
+
+        std::string pos_impl(size_t offset) {
+            return source.Pos(source_position{offset, 0});
+        }
+
+        void seek_impl(size_t length) {
+            position += length;
+        }
+
+        // Positions are source offsets; tokens that have left the ring render as an empty string.
+        std::string value_impl(size_t offset) {
+            fill(1);
+            auto resident = std::views::iota(ring_begin, ring_end);
+            auto index = std::ranges::partition_point(resident, [&](size_t i) {
+                return offsets[i & mask] < offset;
+            });
+            if (index == resident.end() || offsets[*index & mask] != offset)
+                return "";
+            return value_func(tokens[*index & mask]);
+        }
+
+        snap_shot save_impl() {
+            return {this, position};
+        }
+
+        void restore_impl(const snap_shot &state) {
+            position = state.index;
+        }
+
+        void pin(size_t index) {
+            if (pin_count++ == 0 || index < pin_floor)
+                pin_floor = index;
+        }
+
+        void unpin() {
+            --pin_count;
+        }
+
+        // Lexes until `required` tokens from the cursor are in the ring or the source ends.
+        bool fill(size_t required) {
+            const size_t target = position + required;
+            while (ring_end < target) {
+                if (source_end || !lex_next())
+                    return false;
+            }
+            return true;
+        }
+
+        bool lex_next() {
+            if constexpr (!std::is_same_v<skip_type, std::nullptr_t>)
+                skip.Parse(source);
+            if (source.Eof()) {
+                source_end = true;
+                return false;
+            }
+
+            size_t offset = source.Position().offset;
+            auto token = lexer.Parse(source);
+            if (!token) {
+                throw std::runtime_error("Failed to lex token at " + source.Pos(source_position{offset, 0}));
+            }
+
+            // Tokens behind the cursor and every live snapshot are dead; grow only if the live range fills the ring.
+            size_t keep_from = std::min(pin_count ? std::min(pin_floor, position) : position, ring_end);
+            ring_begin = std::max(ring_begin, keep_from);
+            if (ring_end - ring_begin == tokens.size())
+                grow();
+
+            tokens[ring_end & mask] = std::move(*token);
+            offsets[ring_end & mask] = offset;
+            ring_end++;
+            return true;
+        }
+
+        void grow() {
+            size_t new_capacity = tokens.empty() ? 16 : tokens.size() * 2;
+            std::vector<value_type> new_tokens(new_capacity);
+            std::vector<size_t> new_offsets(new_capacity);
+            for (size_t i = ring_begin; i < ring_end; i++) {
+                new_tokens[i & (new_capacity - 1)] = std::move(tokens[i & mask]);
+                new_offsets[i & (new_capacity - 1)] = offsets[i & mask];
+            }
+            tokens = std::move(new_tokens);
+            offsets = std::move(new_offsets);
+            mask = new_capacity - 1;
+        }
+
+    public:
+        // Lexes `_source` from its current position. The source must outlive this stream.
+        lexer_stream(source_type &_source, lexer_type _lexer, skip_type _skip = skip_type{})
+                : source(_source), lexer(std::move(_lexer)), skip(std::move(_skip)),
+                  value_func(default_token_value<value_type>) {
+            this->name = std::string(source.Name());
+        }
+
+        lexer_stream(const lexer_stream &) = delete;
+        lexer_stream &operator=(const lexer_stream &) = delete;
+
+        std::string (*value_func)(const value_type &);
+    };
+
+    template<typename source_type, typename lexer_type>
+    auto LexerStream(source_type &source, lexer_type &&lexer) {
+        return lexer_stream<source_type, std::decay_t<lexer_type>>(source, std::forward<lexer_type>(lexer));
+    }
+
+    template<typename source_type, typename lexer_type, typename skip_type>
+    auto LexerStream(source_type &source, lexer_type &&lexer, skip_type &&skip) {
+        return lexer_stream<source_type, std::decay_t<lexer_type>, std::decay_t<skip_type>>(
+                source, std::forward<lexer_type>(lexer), std::forward<skip_type>(skip));
+    }
+
+
+    // Counters collected by instrumented_stream.
+    struct stream_stats {
+        size_t get_calls = 0;
+        size_t peek_calls = 0;
+        size_t seek_calls = 0;
+        size_t eof_calls = 0;
+        size_t window_calls = 0;
+        size_t save_calls = 0;
+        size_t restore_calls = 0;
+
+        // Widest lookahead requested through `Peek` / `Eof` / `Window`, in tokens from the cursor.
+        size_t max_lookahead = 0;
+
+        // Tokens consumed again after a `Restore()` moved the cursor back.
+        size_t reread_tokens = 0;
+    };
+
+
+    // Opt-in wrapper that forwards every call to `inner` and counts it in `Stats()`.
+    //  Shows how a grammar uses its input: how far it looks ahead and how much it re-reads after backtracking.
+    //  Call `ResetStats()` between parses to get per-parse figures.
+    template<typename stream_type>
+    class instrumented_stream : public base_token_stream<
+            decltype(std::declval<stream_type &>().Get()), instrumented_stream<stream_type>> {
+    public:
+        using value_type = decltype(std::declval<stream_type &>().Get());
+
+    private:
+        friend class base_token_stream<value_type, instrumented_stream<stream_type>>;
+
+        struct snap_shot {
+            decltype(std::declval<stream_type &>().Save()) state;
+            size_t offset;
+        };
+
+        stream_type &inner;
+        stream_stats stats;
+
+        // Tokens consumed so far and the furthest the cursor has been, to detect re-reads.
+        size_t position = 0;
+        size_t high_water = 0;
+
+        void advance(size_t length) {
+            if (position < high_water)
+                stats.reread_tokens += std::min(length, high_water - position);
+            position += length;
+            high_water = std::max(high_water, position);
+        }
+
+        void look(size_t length) {
+            stats.max_lookahead = std::max(stats.max_lookahead, length);
+        }
+
+        value_type get_impl() {
+            ++stats.get_calls;
+            look(1);
+            advance(1);
+            return inner.Get();
+        }
+
+        value_type peek_impl(size_t lookahead) {
+            ++stats.peek_calls;
+            look(lookahead + 1);
+            return inner.Peek(lookahead);
+        }
+
+        bool eof_impl(size_t lookahead) {
+            ++stats.eof_calls;
+            look(lookahead + 1);
+            return inner.Eof(lookahead);
+        }
+
+        size_t offset_impl() {
+            return inner.Position().offset;
+        }
+
+        size_t index_impl() {
+            return inner.Index();
+        }
+
+        std::string pos_impl(size_t offset) {
+            return inner.Pos(source_position{offset, 0});
+        }
+
+        void seek_impl(size_t length) {
+            ++stats.seek_calls;
+            advance(length);
+            inner.Seek(length);
+        }
+
+        std::string value_impl(size_t offset) {
+            return inner.Value(source_position{offset, 0});
+        }
+
+        snap_shot save_impl() {
+            ++stats.save_calls;
+            return {inner.Save(), position};
+        }
+
+        void restore_impl(const snap_shot &state) {
+            ++stats.restore_calls;
+            position = state.offset;
+            inner.Restore(state.state);
+        }
+
+        auto window_impl(size_t length) {
+            ++stats.window_calls;
+            look(length);
+            return inner.Window(length);
+        }
+
+    public:
+        // The wrapped stream must outlive this wrapper.
+        explicit instrumented_stream(stream_type &_inner) : inner(_inner) {
+            this->name = std::string(inner.Name());
+        }
+
+        instrumented_stream(const instrumented_stream &) = delete;
+        instrumented_stream &operator=(const instrumented_stream &) = delete;
+
+        [[nodiscard]] const stream_stats &Stats() const {
+            return stats;
+        }
+
+        // Clears the counters; re-reads are then measured from the current cursor.
+        void ResetStats() {
+            stats = {};
+            high_water = position;
+        }
+    };
+
+    template<typename stream_type>
+    struct is_contiguous_stream<instrumented_stream<stream_type>> : is_contiguous_stream<stream_type> {};
+
+    template<typename stream_type>
+    struct has_stable_window<instrumented_stream<stream_type>> : has_stable_window<stream_type> {};
+
+    template<typename stream_type>
+    auto Instrumented(stream_type &stream) {
+        return instrumented_stream<stream_type>(stream);
+    }
+
+
+    // How parsers report a failure on a stream type, chosen at compile time through `stream_error_policy`.
+    //  `throwing`: through the parser's error handler (the default handler throws `parser_exception`).
+    //  `status`: recorded on the stream with `Fail()` and propagated as `std::nullopt`;
+    //  nothing is thrown, formatted or called through `std::function`.
+    enum class error_policy { throwing, status };
+
+    template<typename stream_type>
+    struct stream_error_policy : std::integral_constant<error_policy, error_policy::throwing> {};
+
+    template<typename stream_type>
+    constexpr error_policy stream_error_policy_v = stream_error_policy<std::remove_cvref_t<stream_type>>::value;
+
+    // The failure recorded by a status_stream: the token index it happened at and the name of the failing parser.
+    struct parse_error {
+        size_t index = 0;
+        std::string_view parser_name;
+    };
+
+    // Wrapper that forwards every call to `inner` and selects the `status` error policy.
+    //  The first failure is kept in `Error()` until `ClearError()`, which TryCatch calls when it recovers;
+    //  a parse failed if it returned std::nullopt or `Failed()` is set afterwards.
+    template<typename stream_type>
+    class status_stream : public base_token_stream<
+            decltype(std::declval<stream_type &>().Get()), status_stream<stream_type>> {
+    public:
+        using value_type = decltype(std::declval<stream_type &>().Get());
+
+    private:
+        friend class base_token_stream<value_type, status_stream<stream_type>>;
+
+        using snap_shot = decltype(std::declval<stream_type &>().Save());
+
+        stream_type &inner;
+        parse_error error;
+        bool failed = false;
+
+        value_type get_impl() {
+            return inner.Get();
+        }
+
+        value_type peek_impl(size_t lookahead) {
+            return inner.Peek(lookahead);
+        }
+
+        bool eof_impl(size_t lookahead) {
+            return inner.Eof(lookahead);
+        }
+
+        size_t offset_impl() {
+            return inner.Position().offset;
+        }
+
+        size_t index_impl() {
+            return inner.Index();
+        }
+
+        std::string pos_impl(size_t offset) {
+            return inner.Pos(source_position{offset, 0});
+        }
+
+        void seek_impl(size_t length) {
+            inner.Seek(length);
+        }
+
+        std::string value_impl(size_t offset) {
+            return inner.Value(source_position{offset, 0});
+        }
+
+        snap_shot save_impl() {
+            return inner.Save();
+        }
+
+        void restore_impl(const snap_shot &state) {
+            inner.Restore(state);
+        }
+
+        auto window_impl(size_t length) {
+            return inner.Window(length);
+        }
+
+    public:
+        // The wrapped stream must outlive this wrapper.
+        explicit status_stream(stream_type &_inner) : inner(_inner) {
+            this->name = std::string(inner.Name());
+        }
+
+        status_stream(const status_stream &) = delete;
+        status_stream &operator=(const status_stream &) = delete;
+
+        // Records a failure of the parser named `parser_name` at the cursor, unless one is already recorded.
+        void Fail(std::string_view parser_name) {
+            if (failed)
+                return;
+            failed = true;
+            error = {this->Index(), parser_name};
+        }
+
+        [[nodiscard]] bool Failed() const {
+            return failed;
+        }
+
+        [[nodiscard]] const parse_error &Error() const {
+            return error;
+        }
+
+        void ClearError() {
+            failed = false;
+            error = {};
+        }
+    };
+
+    template<typename stream_type>
+    struct is_contiguous_stream<status_stream<stream_type>> : is_contiguous_stream<stream_type> {};
+
+    template<typename stream_type>
+    struct has_stable_window<status_stream<stream_type>> : has_stable_window<stream_type> {};
+
+    template<typename stream_type>
+    struct stream_error_policy<status_stream<stream_type>> : std::integral_constant<error_policy, error_policy::status> {};
+
+    template<typename stream_type>
+    auto Status(stream_type &stream) {
+        return status_stream<stream_type>(stream);
+    }
 }
 #endif //LIGHT_PARSER_TOKEN_STREAM_H
@@ -195,6 +195,14 @@ namespace pkuyo::parsers{
                     std::vector<T>
             >>;
 
+    // Non-owning counterpart of result_container_t, used for results viewing the stream's buffer.
+    template<typename T>
+    using result_view_t = std::conditional_t<
+            std::is_same_v<T, char> || std::is_same_v<T, wchar_t>,
+            std::basic_string_view<T>,
+            std::span<const T>
+    >;
+
     template <class L, class R>
     concept weakly_equality_comparable_with =
     requires(std::add_lvalue_reference_t<L> __t, std::add_lvalue_reference_t<R> __u) {
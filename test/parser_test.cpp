@@ -4,6 +4,9 @@
 #include "gtest/gtest.h"
 #include "pkuyo/parser.h"
 #include <cctype>
+#include <deque>
+#include <memory_resource>
+#include <random>
 
 using namespace pkuyo::parsers;
 
@@ -320,6 +323,76 @@ TEST_F(ParserTest, LazyParser) {
 
 
 }
+struct LeftRecursiveTest;
+constexpr auto left_digit = SingleValue<char>(&isdigit) >>= [](auto && t) { return t - '0'; };
+// difference = difference '-' digit | digit
+constexpr auto left_recursive_parser =
+        ((Lazy<char, LeftRecursiveTest>() >> '-' >> left_digit) >>= [](auto && t) {
+            return std::get<0>(t) - std::get<1>(t);
+        }) | left_digit;
+
+struct LeftRecursiveTest : base_parser<char,LeftRecursiveTest> {
+    std::optional<int> parse_impl(auto& stream,auto& g_ctx,auto& ctx) const {
+        return left_recursive_parser.parse_impl(stream,g_ctx,ctx);
+    }
+    bool peek_impl(auto& stream) const {
+        return left_recursive_parser.peek_impl(stream);
+    }
+};
+
+TEST_F(ParserTest, LeftRecursiveLazyParser) {
+    constexpr auto difference = Lazy<char, LeftRecursiveTest>();
+
+    // Left associative: (9 - 2) - 3.
+    string_stream tokens("9-2-3");
+    auto result = difference.Parse(tokens);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(*result, 4);
+    EXPECT_TRUE(tokens.Eof());
+
+    string_stream single("7");
+    EXPECT_EQ(difference.Parse(single), 7);
+
+    // Growth stops before the trailing operator, which is left unconsumed.
+    string_stream trailing("8-1-;");
+    EXPECT_EQ(difference.Parse(trailing), 7);
+    EXPECT_EQ(trailing.Peek(), '-');
+
+    string_stream invalid("-1");
+    EXPECT_FALSE(difference.Peek(invalid));
+}
+
+TEST_F(ParserTest, LeftRecursiveGrowthIsSilent) {
+    constexpr auto difference = Lazy<char, LeftRecursiveTest>();
+
+    // The round that ends the growth is not an error of a successful parse.
+    static int reported = 0;
+    parser_error_handler<char>::DefaultOnError([](const _abstract_parser<char> &,
+                                                  const std::optional<char> &,
+                                                  const lazy_text &,
+                                                  const lazy_text &,
+                                                  const std::string_view &) {
+        reported++;
+    });
+
+    string_stream tokens("9-2-3");
+    EXPECT_EQ(difference.Parse(tokens), 4);
+    EXPECT_EQ(reported, 0);
+
+    // A genuine failure after the growth is still reported.
+    string_stream invalid("9-2x");
+    EXPECT_FALSE((difference >> ';').Parse(invalid).has_value());
+    EXPECT_GT(reported, 0);
+
+    parser_error_handler<char>::DefaultOnError([](const _abstract_parser<char> & parser,
+                                                  const std::optional<char> &,
+                                                  const lazy_text & token_value,
+                                                  const lazy_text & token_pos,
+                                                  const std::string_view & stream_name) {
+        throw parser_exception(parser.Name(), token_value.str(), token_pos.str(), stream_name);
+    });
+}
+
 #if !defined(__GNUC__)  || defined(__clang__)
 
 TEST_F(ParserTest, SelfLazyParser) {
@@ -368,6 +441,21 @@ TEST_F(ParserTest, BackTrack) {
     ASSERT_TRUE(result.has_value());
     EXPECT_EQ(*result, "abccd");
 }
+
+TEST_F(ParserTest, NoErrorPropagation) {
+    // NoError() silences the children of a combinator, not only the combinator itself.
+    auto pair = Check<char>('a') >> 'b';
+    pair.NoError();
+    string_stream mismatch("ac");
+    EXPECT_FALSE(pair.Parse(mismatch).has_value());
+
+    // So Or_BackTrack backtracks out of a failure deep inside an alternative instead of throwing.
+    auto parser = Or_BackTrack(Check<char>('a') >> 'b', Check<char>('a') >> 'c');
+    string_stream tokens("ac");
+    EXPECT_TRUE(parser.Parse(tokens).has_value());
+    EXPECT_TRUE(tokens.Eof());
+}
+
 TEST_F(ParserTest, ErrorRecovery) {
     auto parser = TryCatch(Check<TestToken>(TestToken("expected")),
             Sync(TestToken(";"))).Name("ErrorTest");
@@ -410,6 +498,112 @@ TEST_F(ParserTest, JsonStringParser) {
     EXPECT_EQ(*result,"hello world");
 }
 
+TEST_F(ParserTest, StringViewStreamParsing) {
+    constexpr auto parser = Check<char>('k') >> "ey::" >> Until<char>(';');
+
+    std::string input("key::end;rest");
+    string_view_stream stream(input);
+    auto result = parser.Parse(stream);
+
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(*result, "end");
+    EXPECT_EQ(stream.Peek(), ';');
+
+    std::string_view view(input);
+    string_view_stream prefix(view.substr(0, 3));
+    EXPECT_TRUE(Str<char>("key").Parse(prefix).has_value());
+    EXPECT_TRUE(prefix.Eof());
+
+    const char raw[] = {'k', 'e', 'y'};
+    string_view_stream span_stream{std::span<const char>(raw)};
+    EXPECT_TRUE(Str<char>("key").Parse(span_stream).has_value());
+    EXPECT_TRUE(span_stream.Eof());
+}
+
+TEST_F(ParserTest, SpanStreamParsing) {
+    std::vector<TestToken> tokens = {{"number"},
+                                     {"+"},
+                                     {"number"}};
+    auto parser = Check<TestToken>(TestToken("number")) >> SingleValue<TestToken>(TestToken("+"));
+
+    auto stream = SpanStream(tokens);
+    auto result = parser.Parse(stream);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->value, "+");
+    EXPECT_EQ(stream.Peek().value, "number");
+    EXPECT_EQ(stream.Value(), "number");
+
+    auto owned = ContainerStream(std::move(tokens));
+    EXPECT_TRUE(parser.Parse(owned).has_value());
+    EXPECT_EQ(owned.Peek().value, "number");
+}
+
+TEST_F(ParserTest, ContiguousWindow) {
+    static_assert(is_contiguous_stream_v<string_stream>);
+    static_assert(is_contiguous_stream_v<string_view_stream>);
+    static_assert(is_contiguous_stream_v<container_stream<std::vector<TestToken>>>);
+    static_assert(!is_contiguous_stream_v<file_stream>);
+
+    string_stream stream("<?xml?>");
+    EXPECT_EQ(std::string_view(stream.Window(5).data(), 5), "<?xml");
+    EXPECT_EQ(stream.Window(100).size(), 7);
+
+    constexpr auto parser = SeqCheck<char>("<?xml") >> Str<char>("?>");
+    auto result = parser.Parse(stream);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(*result, "?>");
+    EXPECT_TRUE(stream.Window(1).empty());
+
+    // A literal longer than the remaining input fails without reading past the end.
+    string_stream short_stream("<?x");
+    EXPECT_THROW(Str<char>("<?xml").Parse(short_stream), parser_exception);
+}
+
+TEST_F(ParserTest, StructuredPositions) {
+    string_stream stream("abcd");
+    stream.Seek(2);
+    auto position = stream.Position();
+    stream.Seek(1);
+
+    EXPECT_EQ(position.offset, 2);
+    EXPECT_EQ(stream.Pos(position), "index: 2");
+    EXPECT_EQ(stream.Pos(), "index: 3");
+
+    string_stream other("abcd");
+    other.Seek(2);
+    EXPECT_NE(other.Position(), position);
+
+    static std::string rendered;
+    auto parser = Check<char>('x').OnError([](const _abstract_parser<char> &,
+                                              const std::optional<char> &,
+                                              const lazy_text & token_value,
+                                              const lazy_text & token_pos,
+                                              const std::string_view &) {
+        rendered = token_value.str() + " " + token_pos.str();
+    });
+
+    EXPECT_FALSE(parser.Parse(stream).has_value());
+    EXPECT_EQ(rendered, "d index: 3");
+
+    // A lazy value renders the token it was taken at, even after the stream has moved on.
+    string_stream moving("abcd");
+    moving.Seek(1);
+    auto value = lazy_text::value_of(moving);
+    moving.Seek(2);
+    EXPECT_EQ(value.str(), "b");
+    EXPECT_EQ(moving.Value(), "d");
+    moving.Seek(1);
+    EXPECT_EQ(lazy_text::value_of(moving).str(), "EOF");
+
+    string_stream bytes("h\xC3\xA9llo");
+    auto decoded = Utf8Stream(bytes);
+    decoded.Seek(1);
+    auto accented = lazy_text::value_of(decoded);
+    decoded.Seek(2);
+    EXPECT_EQ(accented.str(), "\xC3\xA9");
+    EXPECT_EQ(decoded.Value(), "l");
+}
+
 TEST_F(ParserTest, FileStreamParsing) {
     std::ofstream tmp("test.tmp");
     tmp << "abccd";
@@ -426,6 +620,90 @@ TEST_F(ParserTest, FileStreamParsing) {
     EXPECT_THROW(file_stream("test1.tmp"),std::runtime_error);
 }
 
+TEST_F(ParserTest, FileStreamRingBuffer) {
+    std::string content;
+    for (int i = 0; i < 500; i++)
+        content += "abccd;";
+    std::ofstream tmp("test_ring.tmp", std::ios::binary);
+    tmp << content;
+    tmp.close();
+
+    // A tiny buffer forces the ring to wrap and discard consumed data many times.
+    file_stream stream("test_ring.tmp", 64);
+    auto parser = *(Or_BackTrack(Str("abcdd"), Str("abcce"), Str("abccd")) >> ';');
+
+    auto result = parser.Parse(stream);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->size(), 500);
+    EXPECT_TRUE(stream.Eof());
+
+    // Lookahead wider than the buffer grows it instead of failing.
+    file_stream wide("test_ring.tmp", 64);
+    EXPECT_EQ(wide.Peek(299), ';');
+    EXPECT_EQ(wide.Get(), 'a');
+
+    std::remove("test_ring.tmp");
+}
+
+TEST_F(ParserTest, PrefetchFileStream) {
+    std::string content;
+    for (int i = 0; i < 2000; i++)
+        content += "abccd;";
+    std::ofstream tmp("test_prefetch.tmp", std::ios::binary);
+    tmp << content;
+    tmp.close();
+
+    // Small blocks keep the I/O thread busy refilling while the parser backtracks.
+    prefetch_file_stream stream("test_prefetch.tmp", 64, 100, 3);
+    auto parser = *(Or_BackTrack(Str("abcdd"), Str("abcce"), Str("abccd")) >> ';');
+
+    auto result = parser.Parse(stream);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->size(), 2000);
+    EXPECT_TRUE(stream.Eof());
+
+    // A live snapshot keeps its data resident beyond the buffer size, so restoring never re-reads the file.
+    prefetch_file_stream rewind("test_prefetch.tmp", 64, 100, 3);
+    {
+        auto state = rewind.Save();
+        rewind.Seek(20);
+        EXPECT_EQ(rewind.Peek(500), content[520]);
+        rewind.Seek(1000);
+        EXPECT_EQ(rewind.Get(), content[1020]);
+        rewind.Restore(state);
+    }
+    EXPECT_EQ(rewind.Get(), 'a');
+    EXPECT_EQ(rewind.Peek(6), 'b');
+
+    std::remove("test_prefetch.tmp");
+}
+
+TEST_F(ParserTest, LazyLinePositions) {
+    std::string content;
+    for (int i = 0; i < 100; i++)
+        content += "line\n";
+    content += "tail";
+    std::ofstream tmp("test_lines.tmp", std::ios::binary);
+    tmp << content;
+    tmp.close();
+
+    file_stream stream("test_lines.tmp", 64);
+    stream.Seek(5 * 99 + 2);
+    EXPECT_EQ(stream.Pos(), " [line:100 , column: 3]");
+    // Consumed lines are discarded from the ring buffer but remain counted.
+    stream.Seek(4);
+    EXPECT_EQ(stream.Peek(), 'a');
+    EXPECT_EQ(stream.Pos(), " [line:101 , column: 2]");
+
+    mmap_file_stream mapped("test_lines.tmp");
+    mapped.Seek(7);
+    EXPECT_EQ(mapped.Pos(), " [line:2 , column: 3]");
+    mapped.Seek(5 * 50);
+    EXPECT_EQ(mapped.Pos(), " [line:52 , column: 3]");
+
+    std::remove("test_lines.tmp");
+}
+
 
 TEST_F(ParserTest, MMAPStreamParsing) {
     std::ofstream tmp("test.tmp");
@@ -444,6 +722,736 @@ TEST_F(ParserTest, MMAPStreamParsing) {
 
 }
 
+TEST_F(ParserTest, IncrementalPushParsing) {
+    constexpr auto record = Check<char>('<') >> Until<char>('>') >> ">";
+
+    push_stream<char> stream;
+    auto session = ParseIncremental(record, stream);
+
+    EXPECT_FALSE(session.Next());
+    EXPECT_TRUE(session.NeedsInput());
+
+    // The first record is yielded as soon as it is complete, even though the next one is still partial.
+    stream.Feed("<ab");
+    EXPECT_FALSE(session.Next());
+    EXPECT_TRUE(session.NeedsInput());
+    stream.Feed("c><de");
+    ASSERT_TRUE(session.Next());
+    EXPECT_EQ(session.Value(), "abc");
+    EXPECT_FALSE(session.Next());
+    EXPECT_TRUE(session.NeedsInput());
+
+    stream.Feed(std::string_view("f>"));
+    ASSERT_TRUE(session.Next());
+    EXPECT_EQ(session.Value(), "def");
+
+    stream.Finish();
+    EXPECT_FALSE(session.Next());
+    EXPECT_TRUE(session.Done());
+    EXPECT_FALSE(session.Failed());
+
+    // A truncated record is reported by the parser's error handler once the input is finished.
+    push_stream<char> truncated;
+    auto broken = ParseIncremental(record, truncated);
+    truncated.Feed("<unterminated");
+    EXPECT_FALSE(broken.Next());
+    truncated.Finish();
+    EXPECT_THROW(broken.Next(), parser_exception);
+
+    // A starved record is retried only once the tokens it stopped at have been fed.
+    //  Semantic actions run on every pass; the complete record is validated, then parsed.
+    int attempts = 0;
+    auto counted = (Check<char>('<') <<= [&attempts](auto &&) { attempts++; }) >> Until<char>('>') >> ">";
+    push_stream<char> slow;
+    auto waiting = ParseIncremental(counted, slow);
+    slow.Feed("<ab");
+    EXPECT_FALSE(waiting.Next());
+    EXPECT_EQ(attempts, 1);
+    EXPECT_FALSE(waiting.Next());
+    EXPECT_TRUE(waiting.NeedsInput());
+    EXPECT_EQ(attempts, 1);
+    slow.Feed("c>");
+    ASSERT_TRUE(waiting.Next());
+    EXPECT_EQ(waiting.Value(), "abc");
+    EXPECT_EQ(attempts, 3);
+
+    // Mappers only run once the record is complete, however finely its input is split.
+    int mapped = 0;
+    auto mapped_record = Check<char>('<') >> (Until<char>('>') >>= [&mapped](std::string &&text) {
+        mapped++;
+        return text.size();
+    }) >> ">" >> ";";
+    push_stream<char> bytes;
+    auto trickle = ParseIncremental(mapped_record, bytes);
+    for (char c : std::string_view("<abcdef>;")) {
+        EXPECT_FALSE(trickle.Next());
+        bytes.Feed(std::string_view(&c, 1));
+    }
+    ASSERT_TRUE(trickle.Next());
+    EXPECT_EQ(trickle.Value(), 6);
+    EXPECT_EQ(mapped, 1);
+    bytes.Finish();
+    EXPECT_FALSE(trickle.Next());
+    EXPECT_EQ(mapped, 1);
+}
+
+TEST_F(ParserTest, Utf8Stream) {
+    constexpr auto word = Until<char32_t>(U',');
+    constexpr auto parser = word >> U',' >> Check<char32_t>(U' ') >> word;
+
+    string_stream bytes("h\xC3\xA9llo, \xE4\xB8\x96\xE7\x95\x8C\xF0\x9F\x98\x80");
+    auto stream = Utf8Stream(bytes);
+    EXPECT_EQ(stream.Peek(1), U'é');
+
+    auto prefix = Until<char32_t>(U'l').Parse(stream);
+    ASSERT_TRUE(prefix.has_value());
+    EXPECT_EQ(std::u32string(prefix->begin(), prefix->end()), U"hé");
+    // Positions stay byte offsets into the source.
+    EXPECT_EQ(stream.Position().offset, 3);
+
+    string_stream again("h\xC3\xA9llo, \xE4\xB8\x96\xE7\x95\x8C\xF0\x9F\x98\x80");
+    auto decoded = Utf8Stream(again);
+    auto result = parser.Parse(decoded);
+    ASSERT_TRUE(result.has_value());
+    auto &[first, second] = *result;
+    EXPECT_EQ(std::u32string(first.begin(), first.end()), U"héllo");
+    EXPECT_EQ(std::u32string(second.begin(), second.end()), U"世界\U0001F600");
+    EXPECT_TRUE(decoded.Eof());
+
+    // Non-contiguous sources are decoded sequence by sequence.
+    std::deque<char> deque_bytes = {'a', '\xC3', '\xA9'};
+    auto deque_source = ContainerStream(deque_bytes);
+    auto deque_stream = Utf8Stream(deque_source);
+    EXPECT_EQ(deque_stream.Get(), U'a');
+    EXPECT_EQ(deque_stream.Get(), U'é');
+    EXPECT_TRUE(deque_stream.Eof());
+
+    // Sequences straddling the decoder's block boundary.
+    std::string long_text(4095, 'a');
+    for (int i = 0; i < 3000; i++)
+        long_text += "\xC3\xA9";
+    string_stream long_bytes(long_text);
+    auto long_stream = Utf8Stream(long_bytes);
+    auto letters = (*Check<char32_t>(U'a') >> *SingleValue<char32_t>(U'é')).Parse(long_stream);
+    ASSERT_TRUE(letters.has_value());
+    EXPECT_EQ(letters->size(), 3000);
+    EXPECT_TRUE(long_stream.Eof());
+
+    string_stream surrogate("ok\xED\xA0\x80");
+    auto invalid = Utf8Stream(surrogate);
+    EXPECT_THROW(invalid.Peek(2), std::runtime_error);
+
+    string_stream truncated("ok\xE4\xB8");
+    auto cut = Utf8Stream(truncated);
+    EXPECT_THROW(cut.Peek(2), std::runtime_error);
+}
+
+#ifndef IS_WINDOWS
+TEST_F(ParserTest, WindowedMmapStream) {
+    std::string content;
+    for (int i = 0; i < 3000; i++)
+        content += "abccd;";
+    {
+        std::ofstream tmp("test_window.tmp", std::ios::binary);
+        tmp << content;
+    }
+
+    // A one-page window slides across the file many times, including while backtracking.
+    windowed_mmap_file_stream stream("test_window.tmp", 1);
+    auto parser = *(Or_BackTrack(Str("abcdd"), Str("abcce"), Str("abccd")) >> ';');
+    auto result = parser.Parse(stream);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->size(), 3000);
+    EXPECT_TRUE(stream.Eof());
+
+    // Rendering a far position indexes lines without moving the window under the cursor.
+    windowed_mmap_file_stream window("test_window.tmp", 1);
+    auto block = window.Window(6);
+    EXPECT_EQ(window.Pos(source_position{content.size() - 1, 0}), std::format(" [line:1 , column: {}]", content.size()));
+    EXPECT_EQ(std::string_view(block.data(), block.size()), "abccd;");
+    EXPECT_EQ(window.Window(6).data(), block.data());
+
+    // Restoring to an offset that was unmapped maps it again.
+    windowed_mmap_file_stream rewind("test_window.tmp", 1);
+    auto state = rewind.Save();
+    rewind.Seek(content.size() - 1);
+    EXPECT_EQ(rewind.Get(), ';');
+    rewind.Restore(state);
+    EXPECT_EQ(rewind.Get(), 'a');
+
+    // Tail mode follows data appended after the stream was opened.
+    windowed_mmap_file_stream tail("test_window.tmp", 1, true);
+    tail.Seek(content.size());
+    EXPECT_TRUE(tail.Eof());
+    {
+        std::ofstream tmp("test_window.tmp", std::ios::binary | std::ios::app);
+        tmp << "\nmore";
+    }
+    EXPECT_FALSE(tail.Eof());
+    EXPECT_EQ(Str("\nmore").Parse(tail), "\nmore");
+    EXPECT_EQ(tail.Pos(), " [line:2 , column: 5]");
+
+    std::remove("test_window.tmp");
+}
+#endif
+
+TEST_F(ParserTest, LexerStream) {
+    // Tokens are words or single punctuation characters, separated by spaces.
+    constexpr auto word = +SingleValue<char>(&isalpha);
+    constexpr auto punct = SingleValue<char>(&ispunct) >>= [](char c) { return std::string(1, c); };
+    constexpr auto lexer = word | punct;
+    constexpr auto spaces = *Check<char>(' ');
+
+    string_stream source("let  x = y ; let z = w ;");
+    auto tokens = LexerStream(source, lexer, spaces);
+
+    auto ident = SingleValue<std::string>([](const std::string &t) { return std::isalpha(t[0]) != 0; });
+    auto binding = Check<std::string>(std::string("let")) >> ident >> std::string("=") >> ident >> std::string(";");
+    auto parser = *binding;
+
+    // Snapshots keep their tokens in the ring while lexing continues past them.
+    {
+        auto state = tokens.Save();
+        EXPECT_EQ(tokens.Peek(9), ";");
+        tokens.Seek(7);
+        EXPECT_EQ(tokens.Get(), "=");
+        tokens.Restore(state);
+    }
+
+    auto result = parser.Parse(tokens);
+    ASSERT_TRUE(result.has_value());
+    ASSERT_EQ(result->size(), 2);
+    EXPECT_EQ(std::get<0>((*result)[1]), "z");
+    EXPECT_TRUE(tokens.Eof());
+
+    // Positions are source offsets of the token start.
+    string_stream again("let  x");
+    auto positioned = LexerStream(again, lexer, spaces);
+    {
+        // A lazy value renders its token as long as a snapshot keeps it in the ring.
+        auto state = positioned.Save();
+        auto first = lazy_text::value_of(positioned);
+        positioned.Seek(1);
+        EXPECT_EQ(positioned.Position().offset, 5);
+        EXPECT_EQ(positioned.Value(), "x");
+        EXPECT_EQ(first.str(), "let");
+    }
+
+    // Input the lexer rejects is reported with its source position.
+    string_stream rejected("let 1");
+    auto failing = LexerStream(rejected, lexer, spaces);
+    failing.Seek(1);
+    try {
+        failing.Peek();
+        FAIL();
+    } catch (const std::runtime_error &e) {
+        EXPECT_STREQ(e.what(), "Failed to lex token at index: 4");
+    }
+}
+
+TEST_F(ParserTest, InstrumentedStream) {
+    string_stream source("abccd;abccd;");
+    auto stream = Instrumented(source);
+    static_assert(is_contiguous_stream_v<decltype(stream)>);
+
+    auto parser = *(Or_BackTrack(Str("abcdd"), Str("abcce"), Str("abccd")) >> ';');
+    auto result = parser.Parse(stream);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->size(), 2);
+
+    const auto &stats = stream.Stats();
+    EXPECT_GT(stats.window_calls, 0);
+    EXPECT_GE(stats.max_lookahead, 5);
+    EXPECT_EQ(stats.reread_tokens, 0);
+
+    // Consuming again after a restore counts as re-read input.
+    string_stream rewinding("abcdef");
+    auto counted = Instrumented(rewinding);
+    auto state = counted.Save();
+    counted.Seek(4);
+    counted.Restore(state);
+    EXPECT_EQ(counted.Get(), 'a');
+    counted.Seek(5);
+    EXPECT_TRUE(counted.Eof());
+    EXPECT_EQ(counted.Stats().save_calls, 1);
+    EXPECT_EQ(counted.Stats().restore_calls, 1);
+    EXPECT_EQ(counted.Stats().reread_tokens, 4);
+    EXPECT_EQ(counted.Position().offset, 6);
+
+    counted.ResetStats();
+    EXPECT_EQ(counted.Stats().get_calls, 0);
+}
+
+static int memo_runs = 0;
+struct MemoNumberRule;
+constexpr auto memo_number = Memo(+SingleValue<char>(&isdigit) <<= [](auto &&) { memo_runs++; });
+
+struct MemoNumberRule : base_parser<char, MemoNumberRule> {
+    std::optional<std::string> parse_impl(auto& stream, auto& g_ctx, auto& ctx) const {
+        return memo_number.parse_impl(stream, g_ctx, ctx);
+    }
+    bool peek_impl(auto& stream) const {
+        return memo_number.peek_impl(stream);
+    }
+};
+
+TEST_F(ParserTest, MemoParser) {
+    int& runs = memo_runs;
+    auto digits = +SingleValue<char>(&isdigit) <<= [&runs](auto &&) { runs++; };
+
+    // Without memoization every alternative re-parses the shared prefix.
+    auto plain = Or_BackTrack(digits >> 'x', digits >> 'y', digits >> 'z');
+    string_stream stream("123z");
+    ASSERT_TRUE(plain.Parse(stream).has_value());
+    EXPECT_EQ(runs, 3);
+
+    // A memoized rule defined once and referenced through Lazy is parsed once per position.
+    runs = 0;
+    constexpr auto number = Lazy<char, MemoNumberRule>();
+    auto memoized = Or_BackTrack(number >> 'x', number >> 'y', number >> 'z');
+    string_stream stream2("123z");
+    auto result = memoized.Parse(stream2);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(*result, "123");
+    EXPECT_EQ(runs, 1);
+    EXPECT_TRUE(stream2.Eof());
+
+    // The cache is per parse: a new stream starts empty.
+    runs = 0;
+    string_stream stream3("45y");
+    ASSERT_TRUE(memoized.Parse(stream3).has_value());
+    EXPECT_EQ(runs, 1);
+
+    // Memo keeps its cache outside the parser, so it fits in constexpr grammars.
+    constexpr auto keyword = Memo(Str("ab"));
+    constexpr auto statement = keyword >> 'c';
+    string_stream abc("abc");
+    EXPECT_EQ(statement.Parse(abc), "ab");
+
+    // The arena is released as soon as the top-level parse returns.
+    struct counting_resource : std::pmr::memory_resource {
+        size_t outstanding = 0;
+        void *do_allocate(size_t bytes, size_t alignment) override {
+            outstanding += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+            outstanding -= bytes;
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+    } counting;
+    auto *previous = std::pmr::set_default_resource(&counting);
+    string_stream stream4("678z");
+    ASSERT_TRUE(memoized.Parse(stream4).has_value());
+    EXPECT_EQ(counting.outstanding, 0);
+    std::pmr::set_default_resource(previous);
+}
+
+TEST_F(ParserTest, FirstSetDispatch) {
+    auto keyword = Str("if") | Str("while") | Check<char>('{') | SingleValue<char>('+') | Str("return");
+    EXPECT_TRUE(keyword.first_set_impl().known);
+    EXPECT_TRUE(keyword.first_set_impl().contains('w'));
+    EXPECT_FALSE(keyword.first_set_impl().contains('x'));
+
+    // Only the alternative starting with 'r' is peeked.
+    string_stream source("return");
+    auto stream = Instrumented(source);
+    auto result = keyword.Parse(stream);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_TRUE(stream.Eof());
+    EXPECT_LE(stream.Stats().peek_calls, 2);
+
+    string_stream unknown("x");
+    EXPECT_FALSE(keyword.Parse(unknown).has_value());
+    EXPECT_FALSE(unknown.Eof());
+
+    // Overlapping or unknown first sets fall back to trying each alternative in order.
+    auto overlapping = (Str("ab") >> 'c') | SingleValue<char>(&isalpha);
+    EXPECT_FALSE(overlapping.first_set_impl().known);
+    string_stream fallback("b");
+    auto letter = overlapping.Parse(fallback);
+    ASSERT_TRUE(letter.has_value());
+    EXPECT_TRUE(fallback.Eof());
+
+    auto sign = (SingleValue<char>('+') | SingleValue<char>('-')) >> SingleValue<char>(&isdigit);
+    string_stream signed_digit("-7");
+    auto digit = sign.Parse(signed_digit);
+    ASSERT_TRUE(digit.has_value());
+    EXPECT_EQ(std::get<0>(*digit), '-');
+    EXPECT_EQ(std::get<1>(*digit), '7');
+}
+
+TEST_F(ParserTest, LookAheadPrediction) {
+    auto digit = SingleValue<char>(&isdigit);
+    auto compare = -Str("x==") >> digit;
+    auto assign = -Str("x=") >> digit;
+
+    auto prefixes = assign.prefix_impl<3>();
+    ASSERT_TRUE(prefixes.known);
+    EXPECT_EQ(prefixes.count, 1);
+    EXPECT_EQ(prefixes.entries[0].size, 2);
+    EXPECT_FALSE(prefixes.entries[0].complete);
+
+    auto keywords = (Str("if") | Str("in")) >> '(';
+    EXPECT_EQ(keywords.prefix_impl<3>().count, 2);
+    EXPECT_TRUE(keywords.prefix_impl<3>().entries[1].complete);
+
+    // Both alternatives start with 'x': three tokens of lookahead pick the right one without backtracking.
+    auto statement = Or_LL<3>(compare, assign);
+    string_stream source("x=5");
+    auto stream = Instrumented(source);
+    auto result = statement.Parse(stream);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(*result, '5');
+    EXPECT_EQ(stream.Stats().save_calls, 0);
+    EXPECT_EQ(stream.Stats().restore_calls, 0);
+
+    string_stream source2("x==7");
+    auto result2 = statement.Parse(source2);
+    ASSERT_TRUE(result2.has_value());
+    EXPECT_EQ(*result2, '7');
+
+    string_stream source3("y=1");
+    EXPECT_FALSE(LookAhead<3>(assign).Peek(source3));
+}
+
+TEST_F(ParserTest, PrattParser) {
+    auto number = +SingleValue<char>(&isdigit) >>= [](auto && digits) { return std::stoi(digits); };
+    auto power = [](int base, int exponent) {
+        int result = 1;
+        while (exponent-- > 0)
+            result *= base;
+        return result;
+    };
+    auto factorial = [](int value) {
+        int result = 1;
+        for (int i = 2; i <= value; i++)
+            result *= i;
+        return result;
+    };
+    auto expression = Pratt(number,
+                            InfixLeft(Check<char>('+'), 1, [](int l, int r) { return l + r; }),
+                            InfixLeft(Check<char>('-'), 1, [](int l, int r) { return l - r; }),
+                            InfixLeft(Check<char>('*'), 2, [](int l, int r) { return l * r; }),
+                            Prefix(Check<char>('-'), 3, [](int v) { return -v; }),
+                            InfixRight(Check<char>('^'), 4, power),
+                            Postfix(Check<char>('!'), 5, factorial));
+
+    auto eval = [&](const char *text) {
+        string_stream stream(text);
+        auto result = expression.Parse(stream);
+        EXPECT_TRUE(stream.Eof()) << text;
+        return result.value_or(-999);
+    };
+    EXPECT_EQ(eval("1+2*3"), 7);
+    EXPECT_EQ(eval("10-4-3"), 3);
+    EXPECT_EQ(eval("2^3^2"), 512);
+    EXPECT_EQ(eval("-2^2"), -4);
+    EXPECT_EQ(eval("2*-3"), -6);
+    EXPECT_EQ(eval("3!+1"), 7);
+    EXPECT_EQ(eval("-3!"), -6);
+
+    string_stream peeked("-1");
+    EXPECT_TRUE(expression.Peek(peeked));
+
+    string_stream incomplete("1+");
+    EXPECT_THROW(expression.Parse(incomplete), parser_exception);
+}
+
+TEST_F(ParserTest, StatusErrorPolicy) {
+    auto parser = Str("key") >> '=' >> Until<char>(';');
+    string_stream source("key:value;");
+    auto stream = Status(source);
+    static_assert(stream_error_policy_v<decltype(stream)> == error_policy::status);
+    static_assert(stream_error_policy_v<string_stream> == error_policy::throwing);
+
+    bool parsed = true;
+    EXPECT_NO_THROW(parsed = parser.Parse(stream).has_value());
+    EXPECT_FALSE(parsed);
+    ASSERT_TRUE(stream.Failed());
+    EXPECT_EQ(stream.Error().index, 3);
+
+    // TryCatch recovers the same way as with exceptions, and reports the recorded failure.
+    size_t reported = 0;
+    auto recovering = TryCatch(-(Str("ab") >> 'c'), Sync<char>(';'),
+                               [&reported](const parse_error &error, auto &) { reported = error.index + 1; });
+    string_stream recovery_source("abx;z");
+    auto recovery_stream = Status(recovery_source);
+    EXPECT_TRUE(recovering.Parse(recovery_stream).has_value());
+    EXPECT_FALSE(recovery_stream.Failed());
+    EXPECT_EQ(reported, 3);
+    EXPECT_EQ(recovery_stream.Peek(), ';');
+
+    // Left-recursion growth stops on a recorded failure instead of a caught exception.
+    string_stream difference_source("9-2-");
+    auto difference_stream = Status(difference_source);
+    constexpr auto difference = Lazy<char, LeftRecursiveTest>();
+    EXPECT_EQ(difference.Parse(difference_stream), 7);
+    EXPECT_FALSE(difference_stream.Failed());
+}
+
+TEST_F(ParserTest, RecognizeOnly) {
+    int mapped = 0;
+    auto word = Map(+SingleValue<char>([](char c) { return std::isalpha(c) != 0; }),
+                    [&mapped](auto &&) { return ++mapped; });
+    auto parser = Str("let") >> -*Check<char>(' ') >> word >> '=' >> Until<char>(';');
+
+    string_stream source("let  value=42;");
+    EXPECT_TRUE(parser.Validate(source));
+    EXPECT_EQ(mapped, 0);
+    EXPECT_EQ(source.Peek(), ';');
+
+    string_stream parse_source("let  value=42;");
+    EXPECT_TRUE(parser.Parse(parse_source).has_value());
+    EXPECT_EQ(mapped, 1);
+
+    // Ignored subtrees skip their containers inside a full parse, but mappers still run for their side effects.
+    auto ignored = -word >> '=';
+    string_stream ignored_source("value=");
+    EXPECT_TRUE(ignored.Parse(ignored_source).has_value());
+    EXPECT_EQ(mapped, 2);
+    string_stream validated_source("value=");
+    EXPECT_TRUE(ignored.Validate(validated_source));
+    EXPECT_EQ(mapped, 2);
+
+    string_stream invalid("let =42;");
+    EXPECT_THROW(parser.Validate(invalid), parser_exception);
+
+    string_stream status_source("let =42;");
+    auto status = Status(status_source);
+    EXPECT_FALSE(parser.Validate(status));
+    EXPECT_EQ(status.Error().index, 4);
+}
+
+TEST_F(ParserTest, CaptureParser) {
+    constexpr auto name = Capture(+SingleValue<char>([](char c) { return std::isalpha(c) != 0; }));
+    constexpr auto attribute = name >> '=' >> Capture('"' >> Until<char>('"') >> '"');
+
+    std::string input = "key=\"value\"";
+    string_view_stream stream(input);
+    auto result = attribute.Parse(stream);
+    ASSERT_TRUE(result.has_value());
+    static_assert(std::is_same_v<decltype(result)::value_type, std::tuple<std::string_view, std::string_view>>);
+    EXPECT_EQ(std::get<0>(*result), "key");
+    EXPECT_EQ(std::get<1>(*result), "\"value\"");
+    // The views point into the borrowed buffer.
+    EXPECT_EQ(std::get<0>(*result).data(), input.data());
+    EXPECT_TRUE(stream.Eof());
+
+    // Non-char tokens are viewed as spans.
+    std::vector<int> numbers = {1, 2, 3, 0};
+    auto numbers_stream = SpanStream(numbers);
+    auto span_result = Capture(+SingleValue<int>([](int v) { return v != 0; })).Parse(numbers_stream);
+    ASSERT_TRUE(span_result.has_value());
+    static_assert(std::is_same_v<decltype(span_result)::value_type, std::span<const int>>);
+    EXPECT_EQ(span_result->size(), 3);
+    EXPECT_EQ(span_result->data(), numbers.data());
+    EXPECT_EQ(numbers_stream.Peek(), 0);
+
+    // Streams without a contiguous buffer copy the consumed tokens.
+    std::deque<char> bytes = {'a', 'b', ';'};
+    auto deque_stream = ContainerStream(bytes);
+    auto copied = Capture(Until<char>(';')).Parse(deque_stream);
+    ASSERT_TRUE(copied.has_value());
+    static_assert(std::is_same_v<decltype(copied)::value_type, std::string>);
+    EXPECT_EQ(*copied, "ab");
+    EXPECT_EQ(deque_stream.Peek(), ';');
+
+    // Contiguous streams whose windows are re-decoded or refilled copy as well, so results outlive the window.
+    string_stream utf8_bytes("h\xC3\xA9llo;");
+    auto utf8 = Utf8Stream(utf8_bytes);
+    auto decoded = Capture(Until<char32_t>(U';')).Parse(utf8);
+    ASSERT_TRUE(decoded.has_value());
+    static_assert(std::is_same_v<decltype(decoded)::value_type, std::vector<char32_t>>);
+    utf8.Seek(1);
+    EXPECT_TRUE(utf8.Eof());
+    EXPECT_EQ(std::u32string(decoded->begin(), decoded->end()), U"héllo");
+
+    push_stream<char> pushed;
+    pushed.Feed("ab;");
+    auto fed = Capture(Until<char>(';')).Parse(pushed);
+    static_assert(std::is_same_v<decltype(fed)::value_type, std::string>);
+    pushed.Feed(std::string(4096, 'x'));
+    EXPECT_EQ(fed, "ab");
+}
+
+TEST_F(ParserTest, BulkUntilScan) {
+    // Runs longer than a scan block, with the delimiter at offsets that are not a multiple of the vector width.
+    std::string text(10007, 'x');
+    text[4099] = 'y';
+    std::string input = text + "<tail>";
+
+    string_stream stream(input);
+    auto result = Until<char>('<').Parse(stream);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(*result, text);
+    EXPECT_EQ(stream.Peek(), '<');
+
+    // Streams without Window() keep the per-token loop and give the same result.
+    std::deque<char> bytes(input.begin(), input.end());
+    auto deque_stream = ContainerStream(bytes);
+    EXPECT_EQ(Until<char>('<').Parse(deque_stream), text);
+
+    string_view_stream predicate_stream(input);
+    EXPECT_TRUE(Until<char>([](char c) { return c == 'y'; }).Validate(predicate_stream));
+    EXPECT_EQ(predicate_stream.Index(), 4099);
+
+    string_view_stream unterminated(text);
+    EXPECT_EQ(Until<char>('<').Parse(unterminated), text);
+    EXPECT_TRUE(unterminated.Eof());
+
+    // Sync skips to the recovery point in bulk as well.
+    auto recovering = TryCatch(-(Str("ok") >> ';'), Sync<char>(';'));
+    string_stream recovery_stream(text + ";rest");
+    EXPECT_TRUE(recovering.Parse(recovery_stream).has_value());
+    EXPECT_EQ(recovery_stream.Peek(), ';');
+}
+
+TEST_F(ParserTest, CharSetParser) {
+    constexpr auto identifier = CharSet("a-zA-Z_") >> *CharSet("a-zA-Z0-9_");
+    constexpr auto spaces = -*CharSet(" \t\r\n");
+    constexpr auto digits = +CharSet('0', '9');
+
+    string_stream stream("  snake_case42 = 2025;");
+    spaces.Parse(stream);
+    auto name = identifier.Parse(stream);
+    ASSERT_TRUE(name.has_value());
+    EXPECT_EQ(std::get<0>(*name), 's');
+    EXPECT_EQ(std::get<1>(*name), "nake_case42");
+    spaces.Parse(stream);
+    EXPECT_EQ(stream.Peek(), '=');
+    stream.Seek(1);
+    spaces.Parse(stream);
+    EXPECT_EQ(digits.Parse(stream), "2025");
+
+    // Negated classes, escapes and bytes above 0x7F.
+    constexpr auto not_quote = +CharSet("^\"\\\\");
+    string_stream quoted("caf\xC3\xA9 \\\"");
+    EXPECT_EQ(not_quote.Parse(quoted), "caf\xC3\xA9 ");
+    EXPECT_EQ(quoted.Peek(), '\\');
+    constexpr auto dash = CharSet("+-");
+    string_stream signs("-,");
+    EXPECT_TRUE(dash.Peek(signs));
+    signs.Seek(1);
+    EXPECT_FALSE(dash.Peek(signs));
+
+    // Long runs are classified in bulk and match the per-token result on other streams.
+    std::string run;
+    for (int i = 0; i < 5000; i++)
+        run += static_cast<char>('a' + i % 26);
+    std::string input = run + "!";
+    string_view_stream view(input);
+    EXPECT_EQ((+CharSet("a-z")).Parse(view), run);
+    EXPECT_EQ(view.Peek(), '!');
+    std::deque<char> bytes(input.begin(), input.end());
+    auto deque_stream = ContainerStream(bytes);
+    EXPECT_EQ((+CharSet("a-z")).Parse(deque_stream), run);
+
+    EXPECT_TRUE(CharSet("a-c").first_set_impl().known);
+    EXPECT_TRUE(CharSet("a-c").first_set_impl().contains('b'));
+    EXPECT_FALSE(CharSet("a-c").first_set_impl().contains('d'));
+
+    // Disjoint classes make an Or dispatchable: the last alternative costs as many peeks as the first.
+    auto token = CharSet("a-z") | CharSet("0-9") | CharSet("+-") | CharSet(" ");
+    EXPECT_TRUE(token.first_set_impl().known);
+    string_stream first_source("a"), last_source(" ");
+    auto first = Instrumented(first_source);
+    auto last = Instrumented(last_source);
+    EXPECT_EQ(token.Parse(first), 'a');
+    EXPECT_EQ(token.Parse(last), ' ');
+    EXPECT_EQ(last.Stats().peek_calls, first.Stats().peek_calls);
+}
+
+TEST_F(ParserTest, KeywordsParser) {
+    constexpr auto literal = Keywords("true", "false", "null", "nullable");
+    static_assert(literal.first_set_impl().known);
+
+    string_stream stream("nullable null,false");
+    EXPECT_EQ(literal.Parse(stream), 3);
+    stream.Seek(1);
+    EXPECT_EQ(literal.Parse(stream), 2);
+    EXPECT_EQ(stream.Peek(), ',');
+    stream.Seek(1);
+    EXPECT_EQ(literal.Parse(stream), 1);
+    EXPECT_TRUE(stream.Eof());
+
+    string_stream partial("nul");
+    EXPECT_FALSE(literal.Peek(partial));
+    EXPECT_THROW(literal.Parse(partial), parser_exception);
+
+    // Keyword sets known only at runtime use the same trie.
+    std::vector<std::string> levels = {"INFO", "WARN", "WARNING", "ERROR"};
+    auto level = Keywords<char>(levels) >>= [&levels](size_t index) { return levels[index]; };
+    string_stream log("WARNING: disk");
+    EXPECT_EQ(level.Parse(log), "WARNING");
+    EXPECT_EQ(log.Peek(), ':');
+
+    std::deque<char> bytes = {'E', 'R', 'R', 'O', 'R'};
+    auto deque_stream = ContainerStream(bytes);
+    EXPECT_EQ(Keywords<char>(levels).Parse(deque_stream), 3);
+}
+
+TEST_F(ParserTest, RegexParser) {
+    const auto number = Regex(R"(-?\d+(?:\.\d+)?(?:[eE][+-]?\d+)?)");
+    const auto string = Regex(R"("(?:\\.|[^"\\])*")");
+
+    std::string input = "-12.5e+3,\"a\\\"b\" 0x1F";
+    string_view_stream stream(input);
+    auto parsed = number.Parse(stream);
+    ASSERT_TRUE(parsed.has_value());
+    static_assert(std::is_same_v<decltype(parsed)::value_type, std::string_view>);
+    EXPECT_EQ(*parsed, "-12.5e+3");
+    EXPECT_EQ(parsed->data(), input.data());
+    stream.Seek(1);
+    EXPECT_EQ(string.Parse(stream), "\"a\\\"b\"");
+    stream.Seek(1);
+
+    // Leftmost-longest: the longer alternative wins regardless of order.
+    EXPECT_EQ(Regex("0|0x[0-9a-fA-F]{1,4}").Parse(stream), "0x1F");
+    EXPECT_TRUE(stream.Eof());
+
+    // A failed match consumes nothing; the longest accepted prefix is kept when the DFA dies later.
+    string_stream partial("12.x");
+    EXPECT_FALSE(Regex(R"(\d+\.\d+)").Peek(partial));
+    EXPECT_EQ(number.Parse(partial), "12");
+    EXPECT_EQ(partial.Peek(), '.');
+
+    // Matches longer than the first window, and streams without Window().
+    std::string digits(300, '7');
+    string_stream long_stream(digits + ";");
+    EXPECT_EQ(Regex("[0-9]+").Parse(long_stream)->size(), 300);
+    std::deque<char> bytes = {'a', 'b', 'b', 'c'};
+    auto deque_stream = ContainerStream(bytes);
+    EXPECT_EQ(Regex("ab*").Parse(deque_stream), "abb");
+
+    // Patterns with exponentially many DFA states keep a bounded cache and still match correctly.
+    std::mt19937 random(25);
+    std::string ab(50000, 'a');
+    for (auto &c : ab)
+        c = random() % 2 ? 'a' : 'b';
+    size_t last_a = ab.rfind('a', ab.size() - 21);
+    regex_dfa blowup("(a|b)*a(a|b){20}");
+    int32_t state = blowup.start();
+    size_t longest = 0, peak = 0;
+    for (size_t i = 0; i < ab.size() && state != regex_dfa::dead; i++) {
+        state = blowup.next(state, ab[i]);
+        if (state != regex_dfa::dead && blowup.accepting(state))
+            longest = i + 1;
+        peak = std::max(peak, blowup.cached_states());
+    }
+    EXPECT_EQ(peak, regex_dfa::max_states);
+    EXPECT_EQ(longest, last_a + 21);
+    string_view_stream ab_stream(ab);
+    EXPECT_EQ(Regex("(a|b)*a(a|b){20}").Parse(ab_stream)->size(), last_a + 21);
+
+    EXPECT_THROW(Regex("(ab"), std::runtime_error);
+    EXPECT_THROW(Regex("[a-"), std::runtime_error);
+    EXPECT_THROW(Regex("*a"), std::runtime_error);
+}
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();